@@ -0,0 +1,159 @@
+#include "Benchmark.hpp"
+#include "ProgramGenerator.hpp"
+
+#include "../src/BatchVm.hpp"
+#include "../src/Bytecode.hpp"
+#include "../src/ColumnFile.hpp"
+#include "../src/Parser.hpp"
+#include "../src/Scan.hpp"
+#include "../src/Tokenizer.hpp"
+#include "../src/Vm.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+namespace
+{
+// Rows each program is run over.
+const uint64_t ROWS = 1 << 18;
+
+/**
+ * @brief NullBuffer throws away everything written to it, so the row at a
+ * time runs measure producing output rather than the terminal.
+ */
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        return count;
+    }
+};
+
+/**
+ * @brief rowText returns the columns as text a row at a time, the input the
+ * Vm would need to run the program once per row.
+ */
+std::string rowText(const ColumnFile& columns, size_t used)
+{
+    std::string text;
+    char digits[24];
+
+    for (uint64_t row = 0; row < columns.rows(); row++) {
+        for (size_t column = 0; column < used; column++) {
+            auto result = std::to_chars(digits, digits + sizeof(digits),
+                                        columns.column(column)[row]);
+            text.append(digits, result.ptr);
+            text += ' ';
+        }
+        text += '\n';
+    }
+
+    return text;
+}
+
+void run(const std::string& name, const bench::GeneratorOptions& options)
+{
+    Tokenizer tokenizer;
+    tokenizer.loadSource(bench::generateProgram(options));
+
+    Parser parser{tokenizer};
+    if (!parser.parse()) {
+        return;
+    }
+
+    Bytecode bytecode = Bytecode::compile(parser.ast());
+    uint32_t reads = BatchVm::inputColumns(bytecode);
+
+    std::string inputFile =
+        (std::filesystem::temp_directory_path() / "batch_bench.columns")
+            .string();
+    ColumnFile input;
+
+    if (!bench::generateColumns(options.seed, reads, ROWS, inputFile) ||
+        !input.open(inputFile)) {
+        std::cout << "Unable to write " << inputFile << "." << std::endl;
+        return;
+    }
+
+    std::printf("%-20s %6zu instructions, %u columns in, %u out\n",
+                name.c_str(), bytecode.code().size(), reads,
+                BatchVm::outputColumns(bytecode));
+
+    // Once per row on the Vm, reading the row as text.
+    std::string text = rowText(input, reads);
+    NullBuffer nullBuffer;
+    std::ostream output{&nullBuffer};
+
+    double vmTime = bench::bestOf(3, [&] {
+        std::istringstream rows{text};
+        Vm vm{rows, output};
+
+        for (uint64_t row = 0; row < ROWS; row++) {
+            vm.run(bytecode);
+        }
+    });
+
+    std::printf("  vm, row at a time %10.2f Mrows/s\n", ROWS / vmTime / 1e6);
+
+    // A batch at a time with each kernel the CPU supports. The output is
+    // summed so it has to be produced, and so the kernels can be seen to
+    // agree.
+    scan::Level best = scan::level();
+
+    for (auto level : {scan::Level::SCALAR, scan::Level::SSE2,
+                       scan::Level::AVX2}) {
+        if (scan::setLevel(level) != level) {
+            continue;
+        }
+
+        BatchVm vm;
+        uint64_t sum = 0;
+
+        double batchTime = bench::bestOf(3, [&] {
+            sum = 0;
+            vm.run(bytecode, input,
+                   [&](uint32_t, uint64_t, const int64_t* values,
+                       size_t count) {
+                       for (size_t i = 0; i < count; i++) {
+                           sum += static_cast<uint64_t>(values[i]);
+                       }
+                   });
+        });
+
+        std::printf("  batch (%-6s)     %10.2f Mrows/s %6zu rows a batch, "
+                    "checksum %016llx\n",
+                    scan::levelName(level), ROWS / batchTime / 1e6,
+                    vm.batchRows(), static_cast<unsigned long long>(sum));
+    }
+
+    scan::setLevel(best);
+    input.close();
+    std::filesystem::remove(inputFile);
+}
+} // namespace
+
+int main()
+{
+    // Programs of a few sizes, reading a handful of values per row.
+    for (size_t bytes : {512, 2048, 8192}) {
+        bench::GeneratorOptions options;
+        options.bytes = bytes;
+        options.variables = 16;
+        options.assignWeight = 8;
+
+        run("generated " + std::to_string(bytes) + "B", options);
+    }
+
+    return 0;
+}
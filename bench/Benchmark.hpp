@@ -0,0 +1,66 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace bench
+{
+/**
+ * @brief bestOf runs a function repeatedly and returns the fastest run, which
+ * is the least disturbed by whatever else the machine is doing.
+ * @param repetitions the number of times to run the function
+ * @param function the function to time
+ * @return the fastest run in seconds
+ */
+template <typename Function>
+double bestOf(int repetitions, Function&& function)
+{
+    double best = 0;
+
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+
+    return best;
+}
+
+inline bool readFile(const std::string& fileName, std::string& contents)
+{
+    std::ifstream fileStream{fileName, std::ios::binary};
+
+    if (!fileStream.is_open()) {
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>(fileStream),
+                    std::istreambuf_iterator<char>());
+    return true;
+}
+
+/**
+ * @brief report prints one line of results as throughput figures.
+ */
+inline void report(const std::string& name,
+                   size_t bytes,
+                   size_t tokens,
+                   double seconds)
+{
+    std::printf("%-28s %10.3f ms %10.1f MB/s %10.2f Mtokens/s\n",
+                name.c_str(), seconds * 1e3, bytes / seconds / 1e6,
+                tokens / seconds / 1e6);
+}
+} // namespace bench
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,165 @@
+#include "Benchmark.hpp"
+#include "ProgramGenerator.hpp"
+
+#include "../src/Driver.hpp"
+#include "../src/Parser.hpp"
+#include "../src/Tokenizer.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief bestOfWithSetup is {@code bench::bestOf} for functions that need a
+ * fresh object each run, which is made by {@code setup} outside the timing.
+ */
+template <typename Setup, typename Function>
+double bestOfWithSetup(int repetitions, Setup&& setup, Function&& function)
+{
+    double best = 0;
+
+    for (int i = 0; i < repetitions; i++) {
+        auto state = setup();
+
+        auto start = std::chrono::steady_clock::now();
+        function(*state);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+
+    return best;
+}
+
+size_t countTokens(const std::string& fileName)
+{
+    Tokenizer tokenizer;
+    tokenizer.mapFile(fileName);
+
+    size_t tokens = 1;
+    while (tokenizer.nextToken().type != Token::Type::TEOF) {
+        tokens++;
+    }
+
+    return tokens;
+}
+
+/**
+ * @brief run measures each stage of compiling a file, from lexing on its own
+ * to compiling end to end.
+ */
+void run(const std::string& name, const std::string& fileName)
+{
+    size_t bytes = std::filesystem::file_size(fileName);
+    size_t tokens = countTokens(fileName);
+
+    // Enough runs to smooth out small inputs without dragging on large ones.
+    int repetitions = bytes < (1 << 20) ? 20 : bytes < (64 << 20) ? 5 : 2;
+
+    std::cout << name << " (" << bytes << " bytes, " << tokens << " tokens)"
+              << std::endl;
+
+    // Reads the whole file and lexes every token up front.
+    double loadTime = bench::bestOf(repetitions, [&] {
+        Tokenizer tokenizer;
+        tokenizer.loadFile(fileName);
+    });
+    bench::report("  Tokenizer::loadFile", bytes, tokens, loadTime);
+
+    // Lexes one token at a time from a mapped file, as the parser does.
+    double lexTime = bench::bestOf(repetitions, [&] {
+        Tokenizer tokenizer;
+        tokenizer.mapFile(fileName);
+        while (tokenizer.nextToken().type != Token::Type::TEOF) {
+        }
+    });
+    bench::report("  Tokenizer::readNextToken", bytes, tokens, lexTime);
+
+    // Parses tokens that were already lexed, so only the parser is timed.
+    std::string source;
+    bench::readFile(fileName, source);
+
+    double parseTime = bestOfWithSetup(
+        repetitions,
+        [&] {
+            auto tokenizer = std::make_unique<Tokenizer>();
+            tokenizer->loadSource(source);
+            return tokenizer;
+        },
+        [&](Tokenizer& tokenizer) {
+            Parser parser{tokenizer};
+            parser.parse();
+        });
+    bench::report("  Parser::parse", bytes, tokens, parseTime);
+
+    // Everything from opening the file to bytecode.
+    CompileOptions options;
+    double compileTime = bench::bestOf(
+        repetitions, [&] { compileFile(fileName, options); });
+    bench::report("  compileFile", bytes, tokens, compileTime);
+
+    options.optimize = true;
+    options.bytecode = true;
+    double bytecodeTime = bench::bestOf(
+        repetitions, [&] { compileFile(fileName, options); });
+    bench::report("  compileFile -O to bytecode", bytes, tokens, bytecodeTime);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Benchmark the given files, or generated programs of growing size if
+    // there are none.
+    if (argc >= 2) {
+        for (int i = 1; i < argc; i++) {
+            if (!std::filesystem::is_regular_file(argv[i])) {
+                std::cout << "Unable to load " << argv[i] << "." << std::endl;
+                return 1;
+            }
+
+            run(argv[i], argv[i]);
+        }
+
+        return 0;
+    }
+
+    std::string fileName =
+        (std::filesystem::temp_directory_path() / "component_bench.pas")
+            .string();
+
+    struct Input
+    {
+        const char* name;
+        size_t bytes;
+        double errorRate;
+    };
+
+    const std::vector<Input> inputs{
+        {"generated 64K", 64 << 10, 0},
+        {"generated 1M", 1 << 20, 0},
+        {"generated 16M", 16 << 20, 0},
+        {"generated 16M, 1% errors", 16 << 20, 0.01},
+    };
+
+    for (const Input& input : inputs) {
+        bench::GeneratorOptions options;
+        options.bytes = input.bytes;
+        options.errorRate = input.errorRate;
+
+        std::ofstream file{fileName, std::ios::binary};
+        bench::generateProgram(options, file);
+        file.close();
+
+        run(input.name, fileName);
+    }
+
+    std::filesystem::remove(fileName);
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "Benchmark.hpp"
+
+#include "../src/Document.hpp"
+#include "../src/Parser.hpp"
+#include "../src/Tokenizer.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Repeated to build a synthetic input when no files are given.
+const char* SAMPLE_STATEMENTS = "    ReAD(alpha, beta_2, gamma);\n"
+                                "    total := (alpha + 125) - beta_2 + gamma;\n"
+                                "    WRITE(total - (1 + alpha), 10, beta_2);\n"
+                                "    s_1 := (total) - 10;\n";
+
+std::string makeSource(size_t targetBytes)
+{
+    std::string source = "BEGIN\n";
+
+    while (source.length() < targetBytes) {
+        source += SAMPLE_STATEMENTS;
+    }
+
+    source += "END\n";
+    return source;
+}
+
+bool sameDiagnostics(const std::vector<Diagnostic>& a,
+                     const std::vector<Diagnostic>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].expected != b[i].expected || a[i].actual != b[i].actual ||
+            a[i].lineNumber != b[i].lineNumber ||
+            a[i].columnNumber != b[i].columnNumber ||
+            a[i].offset != b[i].offset) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief matchesFullParse checks that an edited document has the text,
+ * diagnostics and tree that parsing its text from scratch gives, which is
+ * what the incremental parse has to reproduce. Trees are compared as dumps,
+ * as symbol IDs may differ.
+ */
+bool matchesFullParse(const Document& document, const std::string& text)
+{
+    if (document.text() != text) {
+        std::cout << "  warning: the document's text is wrong" << std::endl;
+        return false;
+    }
+
+    Tokenizer tokenizer;
+    tokenizer.viewSource(text.data(), 0, text.length());
+
+    Parser parser{tokenizer};
+    parser.parse();
+
+    if (!sameDiagnostics(document.diagnostics(),
+                         parser.diagnostics().diagnostics())) {
+        std::cout << "  warning: diagnostics differ from a full parse"
+                  << std::endl;
+        return false;
+    }
+
+    Ast ast;
+    document.buildAst(ast);
+
+    std::ostringstream edited;
+    std::ostringstream parsed;
+    ast.dump(edited);
+    parser.ast().dump(parsed);
+
+    if (edited.str() != parsed.str()) {
+        std::cout << "  warning: the tree differs from a full parse"
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief run times a document's edits.
+ * @return false if the edited document stopped matching a full parse
+ */
+bool run(const std::string& name, const std::string& source)
+{
+    std::cout << name << " (" << source.length() << " bytes)" << std::endl;
+
+    // Parsing everything from scratch is what every keystroke used to cost.
+    double parseTime = bench::bestOf(3, [&] {
+        Tokenizer tokenizer;
+        tokenizer.viewSource(source.data(), 0, source.length());
+
+        Parser parser{tokenizer};
+        parser.parse();
+    });
+    std::printf("  full parse                 %10.3f ms\n", parseTime * 1e3);
+
+    auto start = std::chrono::steady_clock::now();
+    Document document{source};
+    std::chrono::duration<double> loadTime =
+        std::chrono::steady_clock::now() - start;
+    std::printf("  document load              %10.3f ms (%zu segments)\n",
+                loadTime.count() * 1e3, document.segmentCount());
+
+    // Type a character somewhere and take it away again, over and over.
+    const int edits = 10000;
+    std::mt19937 random{1};
+    size_t relexed = 0;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < edits; i++) {
+        size_t offset = random() % source.length();
+
+        document.edit(offset, offset, "x");
+        relexed += document.lastEdit().relexedBytes;
+        document.edit(offset, offset + 1, "");
+        relexed += document.lastEdit().relexedBytes;
+    }
+    std::chrono::duration<double> editTime =
+        std::chrono::steady_clock::now() - start;
+
+    std::printf("  edit                       %10.3f us (%.1f bytes relexed)\n",
+                editTime.count() * 1e6 / (2 * edits),
+                static_cast<double>(relexed) / (2 * edits));
+
+    start = std::chrono::steady_clock::now();
+    size_t errors = document.diagnostics().size();
+    std::chrono::duration<double> diagnosticsTime =
+        std::chrono::steady_clock::now() - start;
+    std::printf("  diagnostics                %10.3f ms (%zu errors)\n",
+                diagnosticsTime.count() * 1e3, errors);
+
+    // The edits above leave the text as it was. Check that, then make one
+    // more edit that stays and check again.
+    if (!matchesFullParse(document, source)) {
+        return false;
+    }
+
+    size_t offset = random() % source.length();
+    std::string edited = source;
+    edited.insert(offset, "x");
+    document.edit(offset, offset, "x");
+
+    return matchesFullParse(document, edited);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Benchmark the given files, or a generated program if there are none.
+    if (argc < 2) {
+        return run("generated", makeSource(16 << 20)) ? 0 : 1;
+    }
+
+    bool matched = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string source;
+
+        if (!bench::readFile(argv[i], source)) {
+            std::cout << "Unable to load " << argv[i] << "." << std::endl;
+            return 1;
+        }
+
+        matched &= run(argv[i], source);
+    }
+
+    return matched ? 0 : 1;
+}
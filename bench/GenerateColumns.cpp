@@ -0,0 +1,60 @@
+#include "ProgramGenerator.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+void usage()
+{
+    std::cout << "Usage: generate_columns [options] output\n"
+                 "Writes a column file of random values for --batch.\n"
+                 "  --seed N           seed for the values (1)\n"
+                 "  --columns N        number of columns (8)\n"
+                 "  --rows N           number of rows (1000000)\n";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t seed = 1;
+    size_t columns = 8;
+    uint64_t rows = 1000000;
+    std::string output;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (argument == "--seed" && hasValue) {
+                seed = std::stoull(argv[++i]);
+            } else if (argument == "--columns" && hasValue) {
+                columns = std::stoul(argv[++i]);
+            } else if (argument == "--rows" && hasValue) {
+                rows = std::stoull(argv[++i]);
+            } else if (argument.rfind("--", 0) == 0 || !output.empty()) {
+                usage();
+                return 1;
+            } else {
+                output = argument;
+            }
+        }
+    } catch (const std::logic_error&) {
+        usage();
+        return 1;
+    }
+
+    if (output.empty()) {
+        usage();
+        return 1;
+    }
+
+    if (!bench::generateColumns(seed, columns, rows, output)) {
+        std::cout << "Unable to write " << output << "." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
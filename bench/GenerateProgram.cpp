@@ -0,0 +1,118 @@
+#include "ProgramGenerator.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+void usage()
+{
+    std::cout
+        << "Usage: generate_program [options] [output]\n"
+           "Writes a random program to the output file, or standard output.\n"
+           "  --seed N           seed for the program (1)\n"
+           "  --size N[K|M|G]    size of the program in bytes (1M)\n"
+           "  --mix A:R:W        weights of assignments, READs and WRITEs "
+           "(6:1:2)\n"
+           "  --variables N      number of distinct variables (64)\n"
+           "  --ident-length N   length of variable names (6)\n"
+           "  --depth N          deepest nesting of parentheses (3)\n"
+           "  --operands N       most operands in an expression (4)\n"
+           "  --errors F         fraction of statements with a syntax error "
+           "(0)\n";
+}
+
+// Parses a count with an optional K, M or G suffix, in powers of 1024.
+size_t parseSize(const std::string& text)
+{
+    size_t end = 0;
+    size_t value = std::stoull(text, &end);
+
+    if (end < text.length()) {
+        switch (text[end]) {
+        case 'K':
+        case 'k':
+            return value << 10;
+        case 'M':
+        case 'm':
+            return value << 20;
+        case 'G':
+        case 'g':
+            return value << 30;
+        default:
+            throw std::invalid_argument{text};
+        }
+    }
+
+    return value;
+}
+
+void parseMix(const std::string& text, bench::GeneratorOptions& options)
+{
+    size_t first = text.find(':');
+    size_t second = text.find(':', first + 1);
+
+    if (first == std::string::npos || second == std::string::npos) {
+        throw std::invalid_argument{text};
+    }
+
+    options.assignWeight = std::stoul(text.substr(0, first));
+    options.readWeight = std::stoul(text.substr(first + 1, second - first - 1));
+    options.writeWeight = std::stoul(text.substr(second + 1));
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bench::GeneratorOptions options;
+    std::string output;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (argument == "--seed" && hasValue) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (argument == "--size" && hasValue) {
+                options.bytes = parseSize(argv[++i]);
+            } else if (argument == "--mix" && hasValue) {
+                parseMix(argv[++i], options);
+            } else if (argument == "--variables" && hasValue) {
+                options.variables = parseSize(argv[++i]);
+            } else if (argument == "--ident-length" && hasValue) {
+                options.identifierLength = std::stoul(argv[++i]);
+            } else if (argument == "--depth" && hasValue) {
+                options.depth = std::stoul(argv[++i]);
+            } else if (argument == "--operands" && hasValue) {
+                options.operands = std::stoul(argv[++i]);
+            } else if (argument == "--errors" && hasValue) {
+                options.errorRate = std::stod(argv[++i]);
+            } else if (argument.rfind("--", 0) == 0 || !output.empty()) {
+                usage();
+                return 1;
+            } else {
+                output = argument;
+            }
+        }
+    } catch (const std::logic_error&) {
+        usage();
+        return 1;
+    }
+
+    if (output.empty()) {
+        bench::generateProgram(options, std::cout);
+        return 0;
+    }
+
+    std::ofstream file{output, std::ios::binary};
+    if (!file.is_open()) {
+        std::cout << "Unable to write " << output << "." << std::endl;
+        return 1;
+    }
+
+    bench::generateProgram(options, file);
+    return file ? 0 : 1;
+}
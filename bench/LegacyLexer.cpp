@@ -0,0 +1,284 @@
+#include "LegacyLexer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cwctype>
+#include <limits>
+#include <vector>
+
+namespace
+{
+const std::vector<std::string> SYMBOLS{",", ";"};
+const std::vector<std::string> KEYWORDS{"BEGIN", "END", "READ", "WRITE"};
+} // namespace
+
+size_t LegacyLexer::tokenize(const std::string& source)
+{
+    m_source = &source;
+    m_index = 0;
+    m_lineNumber = 1;
+    m_columnNumber = 1;
+    m_states = std::stack<State>();
+
+    size_t count = 0;
+    Token token;
+
+    // The original tokenizer queued every token except whitespace.
+    do {
+        token = readNextToken();
+
+        if (token.type != Type::WHITESPACE) {
+            count++;
+        }
+    } while (token.type != Type::TEOF);
+
+    return count;
+}
+
+LegacyLexer::Token LegacyLexer::readNextToken()
+{
+    if (m_index >= m_source->length()) {
+        return Token{Type::TEOF, "", m_lineNumber, m_columnNumber};
+    }
+
+    // A lone colon is "recognized" without producing a token, so make sure
+    // that case is reported as unknown rather than left uninitialized.
+    Token token{Type::UNKNOWN, "", m_lineNumber, m_columnNumber};
+
+    push();
+    if (readWhitespace(token)) {
+        return token;
+    }
+    pop();
+
+    push();
+    if (readIdentifier(token)) {
+        if (std::find(std::begin(KEYWORDS), std::end(KEYWORDS), token.data) !=
+            std::end(KEYWORDS)) {
+            token.type = Type::KEYWORD;
+        }
+        return token;
+    }
+    pop();
+
+    push();
+    if (readSymbol(token)) {
+        return token;
+    }
+    pop();
+
+    push();
+    if (readInteger(token)) {
+        return token;
+    }
+    pop();
+
+    push();
+    if (readParens(token)) {
+        return token;
+    }
+    pop();
+
+    push();
+    if (readAssignment(token)) {
+        return token;
+    }
+    pop();
+
+    push();
+    if (readOp(token)) {
+        return token;
+    }
+    pop();
+
+    token = Token{Type::UNKNOWN, "", m_lineNumber, m_columnNumber};
+    m_index = std::numeric_limits<size_t>::max();
+
+    return token;
+}
+
+bool LegacyLexer::readWhitespace(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    while (::iswspace(peek())) {
+        data += next();
+    }
+
+    if (!data.empty()) {
+        outputToken = Token{Type::WHITESPACE, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readIdentifier(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    if (::isalpha(peek())) {
+        data += next();
+
+        while (::isalnum(peek()) || peek() == '_') {
+            data += next();
+        }
+    }
+
+    if (!data.empty()) {
+        for (auto& c : data) {
+            c = ::toupper(c);
+        }
+
+        outputToken = Token{Type::IDENTIFIER, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readSymbol(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    for (auto symbol : SYMBOLS) {
+        for (size_t i = 0; i < symbol.length(); i++) {
+            if (peek() == symbol[i]) {
+                data += next();
+            }
+        }
+    }
+
+    if (!data.empty()) {
+        outputToken = Token{Type::SYMBOL, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readInteger(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    while (::isdigit(peek())) {
+        data += next();
+    }
+
+    if (!data.empty()) {
+        outputToken = Token{Type::INTEGER, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readParens(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+    Type type = Type::UNKNOWN;
+
+    if (peek() == '(') {
+        data += next();
+        type = Type::LPAREN;
+    } else if (peek() == ')') {
+        data += next();
+        type = Type::RPAREN;
+    }
+
+    if (!data.empty()) {
+        outputToken = Token{type, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readAssignment(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    if (peek() == ':') {
+        data += next();
+
+        if (peek() == '=') {
+            data += next();
+        }
+    }
+
+    if (data == ":=") {
+        outputToken = Token{Type::ASSIGNMENT, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+bool LegacyLexer::readOp(Token& outputToken)
+{
+    std::string data;
+    size_t startLine = m_lineNumber;
+    size_t startColumn = m_columnNumber;
+
+    if (peek() == '+' || peek() == '-') {
+        data += next();
+    }
+
+    if (!data.empty()) {
+        outputToken = Token{Type::OP, data, startLine, startColumn};
+    }
+
+    return !data.empty();
+}
+
+char LegacyLexer::next()
+{
+    if (m_source->length() <= m_index) {
+        return EOF;
+    }
+
+    char read = (*m_source)[m_index++];
+
+    if (read == '\r') {
+        m_columnNumber = 0;
+    } else if (read == '\n') {
+        m_columnNumber = 0;
+        m_lineNumber++;
+    }
+
+    m_columnNumber++;
+
+    return read;
+}
+
+char LegacyLexer::peek()
+{
+    if (m_source->length() <= m_index) {
+        return EOF;
+    }
+
+    return (*m_source)[m_index];
+}
+
+void LegacyLexer::push()
+{
+    m_states.push(State{m_index, m_lineNumber, m_columnNumber});
+}
+
+void LegacyLexer::pop()
+{
+    if (!m_states.empty()) {
+        State state = m_states.top();
+        m_states.pop();
+
+        m_index = state.index;
+        m_lineNumber = state.lineNumber;
+        m_columnNumber = state.columnNumber;
+    }
+}
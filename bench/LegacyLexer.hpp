@@ -0,0 +1,77 @@
+#ifndef LEGACYLEXER_HPP
+#define LEGACYLEXER_HPP
+
+#include <cstddef>
+#include <stack>
+#include <string>
+
+/**
+ * @brief LegacyLexer is the original recognizer-chain tokenizer, kept only so
+ * the benchmarks have something to compare the current lexer against. Each
+ * token is tried against every recognizer in turn, saving and restoring the
+ * reading position around each attempt.
+ */
+class LegacyLexer
+{
+public:
+    /**
+     * @brief tokenize reads every token in the source, including whitespace.
+     * @param source the source code to tokenize
+     * @return the number of non-whitespace tokens read, including EOF
+     */
+    size_t tokenize(const std::string& source);
+
+private:
+    struct State
+    {
+        size_t index;
+        size_t lineNumber;
+        size_t columnNumber;
+    };
+
+    enum class Type
+    {
+        IDENTIFIER,
+        KEYWORD,
+        INTEGER,
+        WHITESPACE,
+        SYMBOL,
+        LPAREN,
+        RPAREN,
+        OP,
+        ASSIGNMENT,
+        UNKNOWN,
+        TEOF,
+    };
+
+    struct Token
+    {
+        Type type;
+        std::string data;
+        size_t lineNumber;
+        size_t columnNumber;
+    };
+
+    Token readNextToken();
+
+    bool readWhitespace(Token& outputToken);
+    bool readIdentifier(Token& outputToken);
+    bool readSymbol(Token& outputToken);
+    bool readInteger(Token& outputToken);
+    bool readParens(Token& outputToken);
+    bool readAssignment(Token& outputToken);
+    bool readOp(Token& outputToken);
+
+    char next();
+    char peek();
+    void push();
+    void pop();
+
+    const std::string* m_source;
+    size_t m_index;
+    size_t m_lineNumber;
+    size_t m_columnNumber;
+    std::stack<State> m_states;
+};
+
+#endif // LEGACYLEXER_HPP
@@ -0,0 +1,126 @@
+#include "Benchmark.hpp"
+#include "LegacyLexer.hpp"
+
+#include "../src/Keywords.hpp"
+#include "../src/Scan.hpp"
+#include "../src/Tokenizer.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Repeated to build a synthetic input when no files are given.
+const char* SAMPLE_STATEMENTS = "    ReAD(alpha, beta_2, gamma);\n"
+                                "    total := (alpha + 125) - beta_2 + gamma;\n"
+                                "    WRITE(total - (1 + alpha), 10, beta_2);\n"
+                                "    s_1 := (total) - 10;\n";
+
+std::string makeSource(size_t targetBytes)
+{
+    std::string source = "BEGIN\n";
+
+    while (source.length() < targetBytes) {
+        source += SAMPLE_STATEMENTS;
+    }
+
+    source += "END\n";
+    return source;
+}
+
+// Measures keyword classification on its own, in nanoseconds per identifier.
+void runKeywords()
+{
+    const std::vector<std::string> words{"alpha", "BEGIN", "beta_2", "end",
+                                         "Read",  "total", "WrItE", "s_1",
+                                         "ending", "reader"};
+    const int rounds = 1000000;
+    size_t keywords = 0;
+
+    double time = bench::bestOf(5, [&] {
+        keywords = 0;
+        for (int i = 0; i < rounds; i++) {
+            for (const auto& word : words) {
+                if (classifyKeyword(word.data(), word.length()) !=
+                    Keyword::NONE) {
+                    keywords++;
+                }
+            }
+        }
+    });
+
+    std::printf("keyword classification       %10.2f ns/identifier (%zu "
+                "keywords)\n",
+                time * 1e9 / (rounds * words.size()), keywords);
+}
+
+void run(const std::string& name, const std::string& source)
+{
+    LegacyLexer legacy;
+    size_t legacyTokens = 0;
+    double legacyTime = bench::bestOf(
+        5, [&] { legacyTokens = legacy.tokenize(source); });
+
+    std::cout << name << " (" << source.length() << " bytes)" << std::endl;
+    bench::report("  recognizer chain", source.length(), legacyTokens,
+                  legacyTime);
+
+    // Measure the current lexer with each scanning kernel the CPU supports.
+    scan::Level best = scan::level();
+
+    for (auto level : {scan::Level::SCALAR, scan::Level::SSE2,
+                       scan::Level::AVX2}) {
+        if (scan::setLevel(level) != level) {
+            continue;
+        }
+
+        size_t tokens = 0;
+        double time = bench::bestOf(5, [&] {
+            Tokenizer tokenizer;
+            tokenizer.loadSource(source);
+
+            tokens = 0;
+            while (tokenizer.nextToken().type != Token::Type::TEOF) {
+                tokens++;
+            }
+            tokens++;
+        });
+
+        bench::report(std::string("  Tokenizer (") + scan::levelName(level) +
+                          ")",
+                      source.length(), tokens, time);
+
+        if (tokens != legacyTokens) {
+            std::cout << "  warning: token counts differ (" << legacyTokens
+                      << " vs " << tokens << ")" << std::endl;
+        }
+    }
+
+    scan::setLevel(best);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    runKeywords();
+
+    // Benchmark the given files, or a generated program if there are none.
+    if (argc < 2) {
+        run("generated", makeSource(16 << 20));
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string source;
+
+        if (!bench::readFile(argv[i], source)) {
+            std::cout << "Unable to load " << argv[i] << "." << std::endl;
+            return 1;
+        }
+
+        run(argv[i], source);
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "ProgramGenerator.hpp"
+
+#include "../src/ColumnFile.hpp"
+#include "../src/Keywords.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace bench
+{
+namespace
+{
+// Write the program out whenever this much has been generated.
+const size_t CHUNK_SIZE = 64 * 1024;
+
+const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/**
+ * @brief Random is a splitmix64 generator. Unlike the standard distributions,
+ * it gives the same numbers for a seed everywhere.
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed)
+        : m_state{seed}
+    {}
+
+    uint64_t next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // A number in [0, bound).
+    size_t below(size_t bound)
+    {
+        return bound == 0 ? 0 : static_cast<size_t>(next() % bound);
+    }
+
+    bool chance(double probability)
+    {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53 < probability;
+    }
+
+private:
+    uint64_t m_state;
+};
+
+class Generator
+{
+public:
+    Generator(const GeneratorOptions& options, std::ostream& stream)
+        : m_options{options}
+        , m_stream{stream}
+        , m_random{options.seed}
+        , m_written{0}
+    {
+        makeNames();
+    }
+
+    size_t run()
+    {
+        m_buffer = "BEGIN\n";
+
+        while (m_written + m_buffer.length() < m_options.bytes) {
+            statement();
+
+            if (m_buffer.length() >= CHUNK_SIZE) {
+                flush();
+            }
+        }
+
+        m_buffer += "END\n";
+        flush();
+
+        return m_written;
+    }
+
+private:
+    /**
+     * @brief makeNames gives every variable a distinct name of about the
+     * requested length: random letters, then the variable's number.
+     */
+    void makeNames()
+    {
+        size_t count = std::max<size_t>(1, m_options.variables);
+        size_t width = 1;
+        for (size_t n = count - 1; n >= 36; n /= 36) {
+            width++;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            std::string name(1, LETTERS[m_random.below(52)]);
+
+            while (name.length() + width < m_options.identifierLength) {
+                name += LETTERS[m_random.below(52)];
+            }
+
+            std::string number(width, '0');
+            for (size_t n = i, digit = width; digit-- > 0; n /= 36) {
+                number[digit] = DIGITS[n % 36];
+            }
+            name += number;
+
+            if (classifyKeyword(name.data(), name.length()) != Keyword::NONE) {
+                name.insert(0, "v");
+            }
+
+            m_names.push_back(name);
+        }
+    }
+
+    const std::string& variable()
+    {
+        return m_names[m_random.below(m_names.size())];
+    }
+
+    void statement()
+    {
+        unsigned total = m_options.assignWeight + m_options.readWeight +
+                         m_options.writeWeight;
+        size_t pick = m_random.below(total == 0 ? 1 : total);
+
+        // A statement with an error is a valid one with a piece left out or
+        // added: 1 leaves out := or ), 2 adds an operator, 3 an unbalanced
+        // parenthesis, 4 an unknown character, and 5 leaves out the ;.
+        size_t error = m_random.chance(m_options.errorRate)
+                           ? 1 + m_random.below(5)
+                           : 0;
+
+        m_buffer += "    ";
+
+        if (total == 0 || pick < m_options.assignWeight) {
+            m_buffer += variable();
+            m_buffer += error == 1 ? " " : " := ";
+            expression(0, error);
+        } else if (pick < m_options.assignWeight + m_options.readWeight) {
+            m_buffer += "READ(";
+            size_t count = 1 + m_random.below(3);
+            for (size_t i = 0; i < count; i++) {
+                m_buffer += i == 0 ? "" : ", ";
+                m_buffer += variable();
+            }
+            m_buffer += error != 0 && error != 5 ? "" : ")";
+        } else {
+            m_buffer += "WRITE(";
+            size_t count = 1 + m_random.below(3);
+            for (size_t i = 0; i < count; i++) {
+                m_buffer += i == 0 ? "" : ", ";
+                expression(0, i == 0 ? error : 0);
+            }
+            m_buffer += error == 1 ? "" : ")";
+        }
+
+        m_buffer += error == 5 ? "\n" : ";\n";
+    }
+
+    /**
+     * @brief expression writes an expression, with parentheses nested no
+     * deeper than allowed.
+     * @param error which error to make in it, if any
+     */
+    void expression(size_t depth, size_t error)
+    {
+        size_t operands =
+            1 + m_random.below(std::max<size_t>(1, m_options.operands));
+
+        for (size_t i = 0; i < operands; i++) {
+            if (i != 0) {
+                m_buffer += m_random.below(2) == 0 ? " + " : " - ";
+            }
+
+            // Errors go in the first operand, where every kind can be made.
+            size_t operandError = i == 0 ? error : 0;
+
+            if (operandError == 2) {
+                m_buffer += "+ ";
+            } else if (operandError == 3) {
+                m_buffer += "(";
+            } else if (operandError == 4) {
+                m_buffer += "? ";
+            }
+
+            if (depth < m_options.depth && m_random.below(4) == 0) {
+                m_buffer += "(";
+                expression(depth + 1, 0);
+                m_buffer += ")";
+            } else if (m_random.below(3) == 0) {
+                m_buffer += std::to_string(m_random.below(100000));
+            } else {
+                m_buffer += variable();
+            }
+        }
+    }
+
+    void flush()
+    {
+        m_stream.write(m_buffer.data(),
+                       static_cast<std::streamsize>(m_buffer.length()));
+        m_written += m_buffer.length();
+        m_buffer.clear();
+    }
+
+    const GeneratorOptions& m_options;
+    std::ostream& m_stream;
+    Random m_random;
+
+    std::vector<std::string> m_names;
+
+    std::string m_buffer;
+    size_t m_written;
+};
+} // namespace
+
+size_t generateProgram(const GeneratorOptions& options, std::ostream& stream)
+{
+    Generator generator{options, stream};
+    return generator.run();
+}
+
+std::string generateProgram(const GeneratorOptions& options)
+{
+    std::ostringstream stream;
+    generateProgram(options, stream);
+    return stream.str();
+}
+bool generateColumns(uint64_t seed,
+                     size_t columns,
+                     uint64_t rows,
+                     const std::string& fileName)
+{
+    ColumnWriter writer;
+    if (!writer.open(fileName, columns, rows)) {
+        return false;
+    }
+
+    Random random{seed};
+    std::vector<int64_t> values;
+
+    for (size_t column = 0; column < columns; column++) {
+        values.clear();
+
+        // Mostly small numbers, with the odd one anywhere in range so that
+        // sums overflow now and then.
+        for (uint64_t row = 0; row < rows; row++) {
+            values.push_back(
+                random.chance(1.0 / 64)
+                    ? static_cast<int64_t>(random.next())
+                    : static_cast<int64_t>(random.below(2000001)) - 1000000);
+        }
+
+        writer.write(column, 0, values.data(), values.size());
+    }
+
+    return writer.close();
+}
+} // namespace bench
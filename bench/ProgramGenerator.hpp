@@ -0,0 +1,58 @@
+#ifndef PROGRAMGENERATOR_HPP
+#define PROGRAMGENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace bench
+{
+struct GeneratorOptions
+{
+    // The same seed and options always give the same program.
+    uint64_t seed = 1;
+
+    // Statements are added until the program is at least this long.
+    size_t bytes = 1 << 20;
+
+    // How often each kind of statement is picked, relative to the others.
+    unsigned assignWeight = 6;
+    unsigned readWeight = 1;
+    unsigned writeWeight = 2;
+
+    // How many distinct variables there are, and how long their names are.
+    size_t variables = 64;
+    size_t identifierLength = 6;
+
+    // How deeply parentheses nest, and how many operands each expression
+    // has at most.
+    size_t depth = 3;
+    size_t operands = 4;
+
+    // The fraction of statements with a syntax error in them, from 0 for a
+    // valid program to 1.
+    double errorRate = 0;
+};
+
+/**
+ * @brief generateProgram writes a random program. It's written out in pieces
+ * as it's generated, so programs can be far larger than memory.
+ * @return the number of bytes written
+ */
+size_t generateProgram(const GeneratorOptions& options, std::ostream& stream);
+
+std::string generateProgram(const GeneratorOptions& options);
+
+/**
+ * @brief generateColumns writes a {@code ColumnFile} of random values for
+ * programs to be run over. The same seed always gives the same values.
+ * @return false if the file couldn't be written
+ */
+bool generateColumns(uint64_t seed,
+                     size_t columns,
+                     uint64_t rows,
+                     const std::string& fileName);
+} // namespace bench
+
+#endif // PROGRAMGENERATOR_HPP
@@ -0,0 +1,270 @@
+#include "Benchmark.hpp"
+
+#include "../src/Bytecode.hpp"
+#include "../src/Jit.hpp"
+#include "../src/Optimizer.hpp"
+#include "../src/Parser.hpp"
+#include "../src/Tokenizer.hpp"
+#include "../src/Vm.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Repeated to build a synthetic input when no files are given.
+const char* SAMPLE_STATEMENTS = "    total := (alpha + 125) - beta_2 + gamma;\n"
+                                "    WRITE(total - (1 + alpha), 10, beta_2);\n"
+                                "    s_1 := (total) - 10;\n"
+                                "    alpha := alpha + s_1 - (beta_2 - 3);\n";
+
+std::string makeSource(size_t statements)
+{
+    std::string source = "BEGIN\n    READ(alpha, beta_2, gamma);\n";
+
+    for (size_t i = 0; i < statements; i += 4) {
+        source += SAMPLE_STATEMENTS;
+    }
+
+    source += "END\n";
+    return source;
+}
+
+// Numbers for READ to consume.
+const std::string INPUT = "7 11 13 17 19 23 29 31 37 41 43 47 53 59 61 67";
+
+/**
+ * @brief NullBuffer throws away everything written to it, so the benchmark
+ * measures producing output rather than the terminal.
+ */
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        return count;
+    }
+};
+
+/**
+ * @brief TreeInterpreter runs a program by walking its tree, the way an
+ * interpreter without a compiler would. It's the baseline for the VM.
+ */
+class TreeInterpreter : public AstVisitor
+{
+public:
+    TreeInterpreter(std::istream& input, std::ostream& output)
+        : m_input{input}
+        , m_output{output}
+    {}
+
+    void run(const Ast& ast)
+    {
+        m_variables.assign(ast.symbolCount(), 0);
+        ast.walk(*this);
+    }
+
+    bool enter(const Ast& ast, NodeId id) override
+    {
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::EXPR:
+            m_values.push_back(0);
+            break;
+        case AstNode::Kind::IDENTIFIER:
+            if (m_parents.back() == AstNode::Kind::READ) {
+                m_input >> m_variables[node.value];
+            } else {
+                operand(node, m_variables[node.value]);
+            }
+            break;
+        case AstNode::Kind::INTEGER:
+            operand(node, ast.integer(id));
+            break;
+        default:
+            break;
+        }
+
+        m_parents.push_back(node.kind);
+        return true;
+    }
+
+    void leave(const Ast& ast, NodeId id) override
+    {
+        m_parents.pop_back();
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::ASSIGN:
+            m_variables[node.value] = m_values.back();
+            m_values.pop_back();
+            break;
+        case AstNode::Kind::WRITE:
+            for (size_t i = 0; i < m_values.size(); i++) {
+                m_output << (i == 0 ? "" : " ") << m_values[i];
+            }
+            m_output << "\n";
+            m_values.clear();
+            break;
+        case AstNode::Kind::GROUP: {
+            int64_t value = m_values.back();
+            m_values.pop_back();
+            operand(node, value);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+private:
+    void operand(const AstNode& node, int64_t value)
+    {
+        auto total = static_cast<uint64_t>(m_values.back());
+        auto operand = static_cast<uint64_t>(value);
+
+        m_values.back() = static_cast<int64_t>(
+            node.op == AstNode::Op::PLUS ? total + operand : total - operand);
+    }
+
+    std::istream& m_input;
+    std::ostream& m_output;
+
+    std::vector<int64_t> m_variables;
+    std::vector<int64_t> m_values;
+    std::vector<AstNode::Kind> m_parents;
+};
+
+void run(const std::string& name, const std::string& source)
+{
+    Tokenizer tokenizer;
+    tokenizer.loadSource(source);
+
+    Parser parser{tokenizer};
+    if (!parser.parse()) {
+        return;
+    }
+
+    Bytecode bytecode = Bytecode::compile(parser.ast());
+
+    NullBuffer nullBuffer;
+    std::ostream output{&nullBuffer};
+
+    // Small programs are run over and over to get a measurable time.
+    size_t repetitions = std::max<size_t>(1, 1000000 / bytecode.code().size());
+    double statements =
+        static_cast<double>(bytecode.statements()) * repetitions;
+
+    double treeTime = bench::bestOf(3, [&] {
+        for (size_t i = 0; i < repetitions; i++) {
+            std::istringstream input{INPUT};
+            TreeInterpreter interpreter{input, output};
+            interpreter.run(parser.ast());
+        }
+    });
+
+    auto timeVm = [&](const Bytecode& program) {
+        return bench::bestOf(3, [&] {
+            for (size_t i = 0; i < repetitions; i++) {
+                std::istringstream input{INPUT};
+                Vm vm{input, output};
+                vm.run(program);
+            }
+        });
+    };
+
+    double vmTime = timeVm(bytecode);
+
+    // The same again after optimizing the tree.
+    Optimizer optimizer;
+    optimizer.optimize(parser.ast());
+
+    Bytecode optimized = Bytecode::compile(parser.ast());
+    double optimizedTime = timeVm(optimized);
+
+    // The optimized program again as machine code. It's compiled once, as
+    // it would be for a program run against many inputs.
+    double jitTime = 0;
+    size_t codeSize = 0;
+
+    if (Jit::supported()) {
+        std::istringstream input;
+        Jit jit{input, output};
+
+        if (jit.compile(optimized)) {
+            codeSize = jit.codeSize();
+            jitTime = bench::bestOf(3, [&] {
+                for (size_t i = 0; i < repetitions; i++) {
+                    input.clear();
+                    input.str(INPUT);
+                    jit.run();
+                }
+            });
+        }
+    }
+
+    std::printf("%-36s %6zu instructions, %zu optimized\n", name.c_str(),
+                bytecode.code().size(), optimized.code().size());
+    std::printf("  tree interpreter %12.2f Mstatements/s\n",
+                statements / treeTime / 1e6);
+    std::printf("  vm               %12.2f Mstatements/s %10.2f "
+                "Minstructions/s\n",
+                statements / vmTime / 1e6,
+                static_cast<double>(bytecode.code().size()) * repetitions /
+                    vmTime / 1e6);
+    std::printf("  vm -O            %12.2f Mstatements/s %10.2f "
+                "Minstructions/s\n",
+                statements / optimizedTime / 1e6,
+                static_cast<double>(optimized.code().size()) * repetitions /
+                    optimizedTime / 1e6);
+
+    if (jitTime > 0) {
+        std::printf("  jit -O           %12.2f Mstatements/s %10zu bytes of "
+                    "code\n",
+                    statements / jitTime / 1e6, codeSize);
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> files;
+
+    // Benchmark the given files, or the test programs and a generated program
+    // if there are none.
+    if (argc < 2) {
+        for (const auto& entry : std::filesystem::directory_iterator{TESTS_DIR}) {
+            files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.assign(argv + 1, argv + argc);
+    }
+
+    for (const std::string& file : files) {
+        std::string source;
+
+        if (!bench::readFile(file, source)) {
+            std::cout << "Unable to load " << file << "." << std::endl;
+            return 1;
+        }
+
+        run(std::filesystem::path{file}.filename().string(), source);
+    }
+
+    if (argc < 2) {
+        run("generated", makeSource(1000000));
+    }
+
+    return 0;
+}
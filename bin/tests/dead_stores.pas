@@ -0,0 +1,13 @@
+BEGIN
+    READ(x, y);
+    t := x + 1;
+    u := t - y;
+    x := y - 3;
+    t := x + x;
+    WRITE(t, y);
+    u := t + 100;
+    y := u - x;
+    READ(y);
+    WRITE(y - x);
+    z := y + t;
+END
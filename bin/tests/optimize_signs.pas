@@ -0,0 +1,9 @@
+BEGIN
+    READ(x, y, z);
+    a := (x - x) - y;
+    b := 5 - 5 - y - z;
+    c := (y - (x + y)) - z + x;
+    d := 0 - (x - y);
+    WRITE(a, b, c, d);
+    WRITE(x - (y - (z - x)), (1 - x) - (2 - y), 7 - (y + z));
+END
@@ -0,0 +1,27 @@
+# Runs a program with and without -O, and with -O through the JIT, on the same
+# input and fails if what it writes differs.
+#
+#   cmake -DCOMPILER=<compiler> -DPROGRAM=<program> -DINPUT=<values>
+#         -DWORK_DIR=<dir> -P CompareOptimized.cmake
+
+file(WRITE ${WORK_DIR}/input.txt "${INPUT}")
+
+set(expected "")
+
+foreach(flags "" "-O" "-O;--jit")
+    execute_process(COMMAND ${COMPILER} ${PROGRAM} --run ${flags}
+                    INPUT_FILE ${WORK_DIR}/input.txt
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE status)
+
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "Running with '${flags}' failed:\n${output}")
+    endif()
+
+    if(flags STREQUAL "")
+        set(expected "${output}")
+    elseif(NOT output STREQUAL expected)
+        message(FATAL_ERROR "Output with '${flags}' differs.\n"
+                            "Expected:\n${expected}\nGot:\n${output}")
+    endif()
+endforeach()
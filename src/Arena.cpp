@@ -0,0 +1,72 @@
+#include "Arena.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(size_t blockSize)
+    : m_current{nullptr}
+    , m_end{nullptr}
+    , m_blockSize{blockSize}
+    , m_firstBlockSize{0}
+    , m_bytesAllocated{0}
+{}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    // Round the current position up to the requested alignment.
+    auto address = reinterpret_cast<uintptr_t>(m_current);
+    size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+
+    if (m_current == nullptr ||
+        static_cast<size_t>(m_end - m_current) < padding + size) {
+        addBlock(size + alignment);
+
+        address = reinterpret_cast<uintptr_t>(m_current);
+        padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    }
+
+    char* memory = m_current + padding;
+    m_current = memory + size;
+    m_bytesAllocated += size;
+
+    return memory;
+}
+
+std::string_view Arena::copy(std::string_view text)
+{
+    char* memory = static_cast<char*>(allocate(text.length(), 1));
+    std::memcpy(memory, text.data(), text.length());
+
+    return std::string_view{memory, text.length()};
+}
+
+void Arena::clear()
+{
+    // Keep one ordinary block to reuse, so an arena that's cleared and filled
+    // again over and over doesn't go back to the system every time.
+    if (!m_blocks.empty() && m_firstBlockSize == m_blockSize) {
+        m_blocks.resize(1);
+        m_current = m_blocks[0].get();
+        m_end = m_current + m_blockSize;
+    } else {
+        m_blocks.clear();
+        m_current = nullptr;
+        m_end = nullptr;
+    }
+
+    m_bytesAllocated = 0;
+}
+
+void Arena::addBlock(size_t minimumSize)
+{
+    // Oversized allocations get a block of their own.
+    size_t size = minimumSize > m_blockSize ? minimumSize : m_blockSize;
+
+    if (m_blocks.empty()) {
+        m_firstBlockSize = size;
+    }
+
+    m_blocks.emplace_back(new char[size]);
+    m_current = m_blocks.back().get();
+    m_end = m_current + size;
+}
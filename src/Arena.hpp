@@ -0,0 +1,83 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Arena is a bump allocator. Allocations are carved out of large
+ * blocks and are never freed individually; everything is released at once
+ * when the arena is cleared or destroyed. Memory handed out stays at the same
+ * address for the lifetime of the arena.
+ */
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    /**
+     * @brief allocate returns uninitialized memory from the arena.
+     * @param size the number of bytes to allocate
+     * @param alignment the required alignment, a power of two
+     * @return the allocated memory
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * @brief create constructs an object in the arena. Destructors are never
+     * run, so only trivially destructible types are allowed.
+     */
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "arena objects are never destroyed");
+
+        void* memory = allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief copy stores a copy of a string in the arena.
+     * @return a view of the copy, valid for the lifetime of the arena
+     */
+    std::string_view copy(std::string_view text);
+
+    /**
+     * @brief clear releases every allocation made from the arena. One block
+     * is kept for the allocations that follow.
+     */
+    void clear();
+
+    /**
+     * @brief bytesAllocated returns the total size of all allocations.
+     */
+    size_t bytesAllocated() const
+    {
+        return m_bytesAllocated;
+    }
+
+private:
+    void addBlock(size_t minimumSize);
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+
+    char* m_current;
+    char* m_end;
+
+    size_t m_blockSize;
+    size_t m_firstBlockSize;
+    size_t m_bytesAllocated;
+};
+
+#endif // ARENA_HPP
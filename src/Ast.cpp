@@ -0,0 +1,277 @@
+#include "Ast.hpp"
+
+#include <algorithm>
+
+namespace
+{
+/**
+ * @brief DumpVisitor prints the tree back out in the language's own syntax,
+ * with identifiers in upper case.
+ */
+class DumpVisitor : public AstVisitor
+{
+public:
+    DumpVisitor(std::ostream& stream)
+        : m_stream{stream}
+    {}
+
+    bool enter(const Ast& ast, NodeId id) override
+    {
+        const AstNode& node = ast.node(id);
+
+        // A negative constant is shown as its magnitude, subtracted, as the
+        // grammar has no negative literals.
+        bool negative =
+            node.kind == AstNode::Kind::INTEGER && ast.integer(id) < 0;
+        bool subtracted = (node.op == AstNode::Op::MINUS) != negative;
+
+        // Separate the node from the sibling before it. The grammar has no
+        // unary minus either, so a subtracted first operand is taken from 0.
+        if (!m_parents.empty()) {
+            const AstNode& parent = ast.node(m_parents.back());
+
+            if (parent.firstChild != id) {
+                if (parent.kind == AstNode::Kind::EXPR) {
+                    m_stream << (subtracted ? " - " : " + ");
+                } else if (parent.kind != AstNode::Kind::PROGRAM) {
+                    m_stream << ", ";
+                }
+            } else if (parent.kind == AstNode::Kind::EXPR && subtracted) {
+                m_stream << "0 - ";
+            }
+        }
+
+        switch (node.kind) {
+        case AstNode::Kind::PROGRAM:
+            m_stream << "BEGIN\n";
+            break;
+        case AstNode::Kind::READ:
+            m_stream << "    READ(";
+            break;
+        case AstNode::Kind::WRITE:
+            m_stream << "    WRITE(";
+            break;
+        case AstNode::Kind::ASSIGN:
+            m_stream << "    " << ast.symbolName(node.value) << " := ";
+            break;
+        case AstNode::Kind::GROUP:
+            m_stream << "(";
+            break;
+        case AstNode::Kind::IDENTIFIER:
+            m_stream << ast.symbolName(node.value);
+            break;
+        case AstNode::Kind::INTEGER:
+            if (negative) {
+                m_stream << 0 - static_cast<uint64_t>(ast.integer(id));
+            } else {
+                m_stream << ast.integer(id);
+            }
+            break;
+        case AstNode::Kind::EXPR:
+            break;
+        }
+
+        m_parents.push_back(id);
+        return true;
+    }
+
+    void leave(const Ast& ast, NodeId id) override
+    {
+        m_parents.pop_back();
+
+        switch (ast.node(id).kind) {
+        case AstNode::Kind::PROGRAM:
+            m_stream << "END\n";
+            break;
+        case AstNode::Kind::READ:
+        case AstNode::Kind::WRITE:
+            m_stream << ");\n";
+            break;
+        case AstNode::Kind::ASSIGN:
+            m_stream << ";\n";
+            break;
+        case AstNode::Kind::GROUP:
+            m_stream << ")";
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    std::ostream& m_stream;
+    std::vector<NodeId> m_parents;
+};
+} // namespace
+
+Ast::Ast()
+{}
+
+NodeId Ast::addNode(AstNode::Kind kind, uint32_t offset, uint32_t value)
+{
+    NodeId id = static_cast<NodeId>(m_nodes.size());
+    m_nodes.push_back(AstNode{kind, AstNode::Op::PLUS, offset, NO_NODE,
+                              NO_NODE, NO_NODE, value});
+
+    return id;
+}
+
+NodeId Ast::addInteger(int64_t value, uint32_t offset)
+{
+    uint32_t index = static_cast<uint32_t>(m_integers.size());
+    m_integers.push_back(value);
+
+    return addNode(AstNode::Kind::INTEGER, offset, index);
+}
+
+void Ast::appendChild(NodeId parent, NodeId child)
+{
+    AstNode& parentNode = m_nodes[parent];
+
+    if (parentNode.lastChild == NO_NODE) {
+        parentNode.firstChild = child;
+    } else {
+        m_nodes[parentNode.lastChild].nextSibling = child;
+    }
+
+    parentNode.lastChild = child;
+}
+
+std::vector<Ast::TreeRoom> Ast::makeRoom(const std::vector<const Ast*>& trees)
+{
+    std::vector<TreeRoom> rooms;
+    size_t nodes = m_nodes.size();
+    size_t integers = m_integers.size();
+
+    for (const Ast* tree : trees) {
+        rooms.push_back(TreeRoom{static_cast<NodeId>(nodes - 1),
+                                 static_cast<uint32_t>(integers), NO_NODE,
+                                 0});
+
+        if (!tree->m_nodes.empty()) {
+            nodes += tree->m_nodes.size() - 1;
+        }
+        integers += tree->m_integers.size();
+    }
+
+    // Link the trees' statements onto the end of the root. Only the ends of
+    // each list are needed: a tree's last statement is linked to the next
+    // tree's first when it's copied.
+    AstNode& root = m_nodes[0];
+    NodeId* link = root.lastChild == NO_NODE
+                       ? &root.firstChild
+                       : &m_nodes[root.lastChild].nextSibling;
+
+    for (size_t i = 0; i < trees.size(); i++) {
+        if (trees[i]->m_nodes.empty()) {
+            continue;
+        }
+
+        const AstNode& otherRoot = trees[i]->m_nodes[0];
+        if (otherRoot.firstChild == NO_NODE) {
+            continue;
+        }
+
+        *link = otherRoot.firstChild + rooms[i].nodes;
+        root.lastChild = otherRoot.lastChild + rooms[i].nodes;
+        link = &rooms[i].next;
+    }
+
+    m_nodes.resize(nodes);
+    m_integers.resize(integers);
+
+    return rooms;
+}
+
+void Ast::copyTree(const Ast& other,
+                   const TreeRoom& room,
+                   const std::vector<uint32_t>& symbols)
+{
+    auto move = [&room](NodeId id) {
+        return id == NO_NODE ? NO_NODE : id + room.nodes;
+    };
+
+    for (size_t i = 1; i < other.m_nodes.size(); i++) {
+        AstNode node = other.m_nodes[i];
+
+        node.firstChild = move(node.firstChild);
+        node.lastChild = move(node.lastChild);
+        node.nextSibling = move(node.nextSibling);
+        node.offset += room.offset;
+
+        switch (node.kind) {
+        case AstNode::Kind::ASSIGN:
+        case AstNode::Kind::IDENTIFIER:
+            node.value = symbols[node.value];
+            break;
+        case AstNode::Kind::INTEGER:
+            node.value += room.integers;
+            break;
+        default:
+            break;
+        }
+
+        m_nodes[room.nodes + i] = node;
+    }
+
+    std::copy(other.m_integers.begin(), other.m_integers.end(),
+              m_integers.begin() + room.integers);
+
+    // The last statement is followed by the next tree's first.
+    const AstNode& otherRoot = other.m_nodes[0];
+    if (otherRoot.lastChild != NO_NODE) {
+        m_nodes[move(otherRoot.lastChild)].nextSibling = room.next;
+    }
+}
+
+void Ast::importSymbols(const SymbolTable& symbols)
+{
+    for (size_t i = m_symbolNames.size(); i < symbols.size(); i++) {
+        m_symbolNames.push_back(m_arena.copy(symbols.name(i)));
+    }
+}
+
+void Ast::walk(AstVisitor& visitor, NodeId from) const
+{
+    if (!visitor.enter(*this, from)) {
+        return;
+    }
+
+    // The path from {@code from} to the node being visited. Kept explicitly
+    // rather than recursing, so deeply nested trees can't exhaust the stack.
+    std::vector<NodeId> path{from};
+    NodeId next = m_nodes[from].firstChild;
+
+    while (!path.empty()) {
+        if (next != NO_NODE) {
+            // Descend into the next child, unless the visitor skips it.
+            if (visitor.enter(*this, next)) {
+                path.push_back(next);
+                next = m_nodes[next].firstChild;
+            } else {
+                next = m_nodes[next].nextSibling;
+            }
+        } else {
+            // Out of children, so finish the node and move to its sibling.
+            NodeId done = path.back();
+            path.pop_back();
+            visitor.leave(*this, done);
+
+            next = path.empty() ? NO_NODE : m_nodes[done].nextSibling;
+        }
+    }
+}
+
+void Ast::dump(std::ostream& stream) const
+{
+    DumpVisitor visitor{stream};
+    walk(visitor);
+}
+
+void Ast::clear()
+{
+    m_nodes.clear();
+    m_integers.clear();
+    m_symbolNames.clear();
+    m_arena.clear();
+}
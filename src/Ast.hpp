@@ -0,0 +1,243 @@
+#ifndef AST_HPP
+#define AST_HPP
+
+#include "Arena.hpp"
+#include "SymbolTable.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+using NodeId = uint32_t;
+
+// Marks a missing child or sibling.
+constexpr NodeId NO_NODE = UINT32_MAX;
+
+struct AstNode
+{
+    enum class Kind : uint8_t
+    {
+        // Children are the statements.
+        PROGRAM,
+        // Children are the IDENTIFIERs read into.
+        READ,
+        // Children are the EXPRs written.
+        WRITE,
+        // value is the symbol assigned to, the only child is the EXPR.
+        ASSIGN,
+        // Children are the operands, each with the operator applied to it.
+        EXPR,
+        // A parenthesized expression, the only child is the EXPR.
+        GROUP,
+        // value is the symbol ID.
+        IDENTIFIER,
+        // value indexes the AST's integer constants.
+        INTEGER,
+    };
+
+    enum class Op : uint8_t
+    {
+        PLUS,
+        MINUS,
+    };
+
+    Kind kind;
+
+    // For operands of an EXPR, whether the operand is added or subtracted.
+    // The first operand is always PLUS.
+    Op op;
+
+    // Source offset of the node's first token.
+    uint32_t offset;
+
+    NodeId firstChild;
+    NodeId lastChild;
+    NodeId nextSibling;
+
+    uint32_t value;
+};
+
+class Ast;
+
+/**
+ * @brief AstVisitor receives callbacks as {@code Ast::walk} traverses a tree.
+ */
+class AstVisitor
+{
+public:
+    virtual ~AstVisitor() = default;
+
+    /**
+     * @brief enter is called before a node's children are visited.
+     * @return false to skip the node's children
+     */
+    virtual bool enter(const Ast&, NodeId)
+    {
+        return true;
+    }
+
+    /**
+     * @brief leave is called after all of a node's children were visited.
+     * It isn't called for nodes whose children were skipped.
+     */
+    virtual void leave(const Ast&, NodeId)
+    {}
+};
+
+/**
+ * @brief Ast is a syntax tree stored as one contiguous vector of nodes which
+ * link to each other by index. Identifier spellings are copied into an arena
+ * owned by the tree, so it doesn't depend on the tokenizer that produced it,
+ * and the whole tree is released in one go.
+ */
+class Ast
+{
+public:
+    Ast();
+
+    /**
+     * @brief addNode creates a node with no children or siblings.
+     * @return the new node's ID
+     */
+    NodeId addNode(AstNode::Kind kind, uint32_t offset, uint32_t value = 0);
+
+    /**
+     * @brief addInteger creates an INTEGER node for a constant.
+     * @return the new node's ID
+     */
+    NodeId addInteger(int64_t value, uint32_t offset);
+
+    /**
+     * @brief appendChild adds a node to the end of another node's children.
+     */
+    void appendChild(NodeId parent, NodeId child);
+
+    AstNode& node(NodeId id)
+    {
+        return m_nodes[id];
+    }
+
+    const AstNode& node(NodeId id) const
+    {
+        return m_nodes[id];
+    }
+
+    size_t size() const
+    {
+        return m_nodes.size();
+    }
+
+    /**
+     * @brief root returns the PROGRAM node, or NO_NODE if the tree is empty.
+     */
+    NodeId root() const
+    {
+        return m_nodes.empty() ? NO_NODE : 0;
+    }
+
+    /**
+     * @brief integer returns the constant of an INTEGER node.
+     */
+    int64_t integer(NodeId id) const
+    {
+        return m_integers[m_nodes[id].value];
+    }
+
+    /**
+     * @brief setInteger changes the constant of an INTEGER node.
+     */
+    void setInteger(NodeId id, int64_t value)
+    {
+        m_integers[m_nodes[id].value] = value;
+    }
+
+    /**
+     * @brief TreeRoom is where {@code makeRoom} put the statements of another
+     * tree.
+     */
+    struct TreeRoom
+    {
+        // The other tree's node n becomes node {@code nodes} + n; its root is
+        // left behind.
+        NodeId nodes;
+        uint32_t integers;
+
+        // The statement that follows the other tree's last one.
+        NodeId next;
+
+        // Added to the other tree's source offsets. {@code makeRoom} leaves
+        // it 0; it's for trees parsed from a piece of the source on its own.
+        uint32_t offset;
+    };
+
+    /**
+     * @brief makeRoom grows the tree to hold the statements of other trees on
+     * the end of its root, and returns where each tree's go. Their nodes are
+     * placed one tree after another, so a program parsed in parts and joined
+     * in order has the same node IDs as if it was parsed in one go. The nodes
+     * are filled in by {@code copyTree}.
+     */
+    std::vector<TreeRoom> makeRoom(const std::vector<const Ast*>& trees);
+
+    /**
+     * @brief copyTree copies the statements of another tree into the room
+     * made for it. Copies into different rooms can be made at the same time.
+     * @param other the tree to copy from
+     * @param room where {@code makeRoom} placed the tree
+     * @param symbols maps the other tree's symbol IDs to this tree's
+     */
+    void copyTree(const Ast& other,
+                  const TreeRoom& room,
+                  const std::vector<uint32_t>& symbols);
+
+    /**
+     * @brief importSymbols copies the spellings of any identifiers in the
+     * table the tree doesn't know about yet.
+     */
+    void importSymbols(const SymbolTable& symbols);
+
+    std::string_view symbolName(uint32_t symbol) const
+    {
+        return m_symbolNames[symbol];
+    }
+
+    size_t symbolCount() const
+    {
+        return m_symbolNames.size();
+    }
+
+    /**
+     * @brief walk visits a node and all of its descendants in order. The walk
+     * keeps its own stack, so the depth of the tree is only limited by memory.
+     */
+    void walk(AstVisitor& visitor, NodeId from) const;
+
+    void walk(AstVisitor& visitor) const
+    {
+        if (root() != NO_NODE) {
+            walk(visitor, root());
+        }
+    }
+
+    /**
+     * @brief dump writes the tree back out as source code, one statement per
+     * line. Optimized trees are written as source too: a subtracted first
+     * operand or a negative constant is written as a subtraction.
+     */
+    void dump(std::ostream& stream) const;
+
+    /**
+     * @brief clear removes every node, constant and symbol.
+     */
+    void clear();
+
+private:
+    std::vector<AstNode> m_nodes;
+    std::vector<int64_t> m_integers;
+
+    std::vector<std::string_view> m_symbolNames;
+    Arena m_arena;
+};
+
+#endif // AST_HPP
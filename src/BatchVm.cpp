@@ -0,0 +1,359 @@
+#include "BatchVm.hpp"
+
+#include "Scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BATCH_SSE2 1
+#if defined(__GNUC__)
+// As in the scan kernels, AVX2 code is compiled per function and only run
+// once the CPU is known to support it.
+#define BATCH_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+// A batch's registers are kept to about this size, so they stay in cache
+// while every instruction passes over them.
+const size_t BATCH_BYTES = 256 * 1024;
+
+// Bounds on the rows in a batch: enough to share out the dispatch, and no
+// more than the point where it stops paying.
+const size_t MIN_BATCH_ROWS = 64;
+const size_t MAX_BATCH_ROWS = 1024;
+
+// Every kernel does out[i] = a[i] + b[i] or a[i] - b[i] for i < count, or
+// adds a constant to every lane. Arithmetic wraps, as on the Vm. The output
+// may be one of the inputs.
+using Kernel = void (*)(int64_t*, const int64_t*, const int64_t*, size_t);
+using ConstantKernel = void (*)(int64_t*, const int64_t*, int64_t, size_t);
+
+struct Kernels
+{
+    Kernel add;
+    Kernel subtract;
+    ConstantKernel addConstant;
+};
+
+void addScalar(int64_t* out, const int64_t* a, const int64_t* b, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) +
+                                      static_cast<uint64_t>(b[i]));
+    }
+}
+
+void subtractScalar(int64_t* out,
+                    const int64_t* a,
+                    const int64_t* b,
+                    size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) -
+                                      static_cast<uint64_t>(b[i]));
+    }
+}
+
+void addConstantScalar(int64_t* out, const int64_t* a, int64_t k, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(a[i]) +
+                                      static_cast<uint64_t>(k));
+    }
+}
+
+#ifdef BATCH_SSE2
+// Two lanes to a vector. The integer instructions wrap on overflow.
+template <__m128i (*Op)(__m128i, __m128i)>
+void applySse2(int64_t* out, const int64_t* a, const int64_t* b, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Op(x, y));
+    }
+
+    if (i < count) {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), Op(x, y));
+    }
+}
+
+inline __m128i add2(__m128i x, __m128i y)
+{
+    return _mm_add_epi64(x, y);
+}
+
+inline __m128i subtract2(__m128i x, __m128i y)
+{
+    return _mm_sub_epi64(x, y);
+}
+
+void addConstantSse2(int64_t* out, const int64_t* a, int64_t k, size_t count)
+{
+    __m128i y = _mm_set1_epi64x(k);
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_add_epi64(x, y));
+    }
+
+    addConstantScalar(out + i, a + i, k, count - i);
+}
+#endif
+
+#ifdef BATCH_AVX2
+// Four lanes to a vector, with the last few left to the narrower kernel.
+TARGET_AVX2 void addAvx2(int64_t* out,
+                         const int64_t* a,
+                         const int64_t* b,
+                         size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_add_epi64(x, y));
+    }
+
+    applySse2<add2>(out + i, a + i, b + i, count - i);
+}
+
+TARGET_AVX2 void subtractAvx2(int64_t* out,
+                              const int64_t* a,
+                              const int64_t* b,
+                              size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_sub_epi64(x, y));
+    }
+
+    applySse2<subtract2>(out + i, a + i, b + i, count - i);
+}
+
+TARGET_AVX2 void addConstantAvx2(int64_t* out,
+                                 const int64_t* a,
+                                 int64_t k,
+                                 size_t count)
+{
+    __m256i y = _mm256_set1_epi64x(k);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_add_epi64(x, y));
+    }
+
+    addConstantScalar(out + i, a + i, k, count - i);
+}
+#endif
+
+Kernels kernelsFor(scan::Level level)
+{
+#ifdef BATCH_AVX2
+    if (level == scan::Level::AVX2) {
+        return Kernels{addAvx2, subtractAvx2, addConstantAvx2};
+    }
+#endif
+#ifdef BATCH_SSE2
+    if (level >= scan::Level::SSE2) {
+        return Kernels{applySse2<add2>, applySse2<subtract2>,
+                       addConstantSse2};
+    }
+#endif
+    return Kernels{addScalar, subtractScalar, addConstantScalar};
+}
+
+/**
+ * @brief findUnassignedReads returns the registers the program reads before
+ * it stores anything in them. They hold zero at the start of every row.
+ */
+std::vector<uint32_t> findUnassignedReads(const Bytecode& bytecode)
+{
+    std::vector<bool> assigned(bytecode.registers(), false);
+    std::vector<bool> found(bytecode.registers(), false);
+    std::vector<uint32_t> registers;
+
+    auto read = [&](uint32_t r) {
+        if (!assigned[r] && !found[r]) {
+            found[r] = true;
+            registers.push_back(r);
+        }
+    };
+
+    for (const Instruction& instruction : bytecode.code()) {
+        switch (instruction.opcode) {
+        case Opcode::MOVE:
+        case Opcode::ADDK:
+        case Opcode::SUBK:
+            read(instruction.b);
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+            read(instruction.b);
+            read(instruction.c);
+            break;
+        case Opcode::WRITE:
+            for (uint32_t i = 0; i < instruction.b; i++) {
+                read(instruction.a + i);
+            }
+            continue;
+        default:
+            break;
+        }
+
+        if (instruction.opcode != Opcode::HALT) {
+            assigned[instruction.a] = true;
+        }
+    }
+
+    return registers;
+}
+} // namespace
+
+BatchVm::BatchVm()
+    : m_batchRows{0}
+{}
+
+uint32_t BatchVm::inputColumns(const Bytecode& bytecode)
+{
+    uint32_t columns = 0;
+
+    for (const Instruction& instruction : bytecode.code()) {
+        columns += instruction.opcode == Opcode::READ;
+    }
+
+    return columns;
+}
+
+uint32_t BatchVm::outputColumns(const Bytecode& bytecode)
+{
+    uint32_t columns = 0;
+
+    for (const Instruction& instruction : bytecode.code()) {
+        if (instruction.opcode == Opcode::WRITE) {
+            columns += instruction.b;
+        }
+    }
+
+    return columns;
+}
+
+bool BatchVm::run(const Bytecode& bytecode,
+                  const ColumnFile& input,
+                  const Output& output)
+{
+    m_error.clear();
+
+    // Every row reads the same columns, so a missing one fails them all.
+    if (inputColumns(bytecode) > input.columns()) {
+        size_t reads = 0;
+
+        for (const Instruction& instruction : bytecode.code()) {
+            if (instruction.opcode == Opcode::READ &&
+                reads++ == input.columns()) {
+                size_t columns = input.columns();
+                m_error = "Unable to read a value for " +
+                          bytecode.name(instruction.a) +
+                          ", the input only has " + std::to_string(columns) +
+                          (columns == 1 ? " column." : " columns.");
+                return false;
+            }
+        }
+    }
+
+    Kernels kernels = kernelsFor(scan::level());
+    std::vector<uint32_t> unassigned = findUnassignedReads(bytecode);
+
+    // Whole vectors of rows, as many as fit the budget.
+    size_t registers = std::max<size_t>(1, bytecode.registers());
+    m_batchRows = std::clamp(BATCH_BYTES / (registers * sizeof(int64_t)),
+                             MIN_BATCH_ROWS, MAX_BATCH_ROWS);
+    m_batchRows -= m_batchRows % 8;
+    m_registers.assign(registers * m_batchRows, 0);
+
+    const Instruction* code = bytecode.code().data();
+    const int64_t* constants = bytecode.constants().data();
+    size_t batch = m_batchRows;
+
+    auto r = [&](uint32_t index) {
+        return m_registers.data() + index * batch;
+    };
+
+    for (uint64_t row = 0; row < input.rows(); row += batch) {
+        size_t count = static_cast<size_t>(
+            std::min<uint64_t>(batch, input.rows() - row));
+
+        for (uint32_t index : unassigned) {
+            std::fill_n(r(index), count, 0);
+        }
+
+        uint32_t read = 0;
+        uint32_t written = 0;
+
+        for (const Instruction* ip = code; ip->opcode != Opcode::HALT; ip++) {
+            switch (ip->opcode) {
+            case Opcode::LOADK:
+                std::fill_n(r(ip->a), count, constants[ip->b]);
+                break;
+            case Opcode::MOVE:
+                std::memcpy(r(ip->a), r(ip->b), count * sizeof(int64_t));
+                break;
+            case Opcode::ADD:
+                kernels.add(r(ip->a), r(ip->b), r(ip->c), count);
+                break;
+            case Opcode::SUB:
+                kernels.subtract(r(ip->a), r(ip->b), r(ip->c), count);
+                break;
+            case Opcode::ADDK:
+                kernels.addConstant(r(ip->a), r(ip->b), constants[ip->c],
+                                    count);
+                break;
+            case Opcode::SUBK:
+                // Adding the negation wraps the same way subtracting does.
+                kernels.addConstant(
+                    r(ip->a), r(ip->b),
+                    static_cast<int64_t>(
+                        0 - static_cast<uint64_t>(constants[ip->c])),
+                    count);
+                break;
+            case Opcode::READ:
+                std::memcpy(r(ip->a), input.column(read++) + row,
+                            count * sizeof(int64_t));
+                break;
+            case Opcode::WRITE:
+                for (uint32_t i = 0; i < ip->b; i++) {
+                    output(written++, row, r(ip->a + i), count);
+                }
+                break;
+            case Opcode::HALT:
+                break;
+            }
+        }
+    }
+
+    return true;
+}
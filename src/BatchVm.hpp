@@ -0,0 +1,85 @@
+#ifndef BATCHVM_HPP
+#define BATCHVM_HPP
+
+#include "Bytecode.hpp"
+#include "ColumnFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief BatchVm runs {@code Bytecode} once for every row of a
+ * {@code ColumnFile}, as if each row were the whole input of a separate run
+ * on the {@code Vm}: column i is the value the i-th READ takes, and every
+ * value WRITE prints becomes a column of the output, in order.
+ *
+ * Rather than interpreting the program once per row, it's interpreted once
+ * per batch of thousands of rows. Each register holds a value for every row
+ * of the batch, and each instruction is carried out over all of them at once
+ * with vectorized kernels, so the cost of dispatch is shared by the batch.
+ * The kernels use the implementation {@code scan::level} picks.
+ */
+class BatchVm
+{
+public:
+    /**
+     * @brief Output receives {@code count} values of an output column,
+     * starting at a row. Each batch's columns are handed over in order.
+     */
+    using Output = std::function<void(uint32_t column,
+                                      uint64_t row,
+                                      const int64_t* values,
+                                      size_t count)>;
+
+    BatchVm();
+
+    /**
+     * @brief inputColumns returns how many columns a program reads: one per
+     * READ.
+     */
+    static uint32_t inputColumns(const Bytecode& bytecode);
+
+    /**
+     * @brief outputColumns returns how many columns a program writes: one
+     * per value written.
+     */
+    static uint32_t outputColumns(const Bytecode& bytecode);
+
+    /**
+     * @brief run executes a program over every row of the input. Columns
+     * past the ones the program reads are ignored.
+     * @return false if there aren't enough columns, in which case nothing
+     * is run; see {@code error}
+     */
+    bool run(const Bytecode& bytecode,
+             const ColumnFile& input,
+             const Output& output);
+
+    /**
+     * @brief error describes why the last run failed.
+     */
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+    /**
+     * @brief batchRows returns how many rows the last run did at a time.
+     */
+    size_t batchRows() const
+    {
+        return m_batchRows;
+    }
+
+private:
+    // Register r of the batch is [r * m_batchRows, (r + 1) * m_batchRows).
+    std::vector<int64_t> m_registers;
+    size_t m_batchRows;
+
+    std::string m_error;
+};
+
+#endif // BATCHVM_HPP
@@ -0,0 +1,269 @@
+#include "Bytecode.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+/**
+ * @brief BytecodeCompiler lowers a tree one node at a time as it's walked.
+ *
+ * Every expression has a target register. Its first operand is loaded into
+ * the target and the others are added or subtracted in turn. A parenthesized
+ * operand is evaluated into a temporary first, unless it's the first operand,
+ * in which case it can share its parent's target. Temporaries are handed out
+ * like a stack above the variables.
+ */
+class BytecodeCompiler : public AstVisitor
+{
+public:
+    BytecodeCompiler(Bytecode& bytecode)
+        : m_bytecode{bytecode}
+        , m_temporaries{0}
+        , m_top{0}
+        , m_finished{0}
+        , m_writeBase{0}
+    {}
+
+    void start(const Ast& ast)
+    {
+        for (size_t i = 0; i < ast.symbolCount(); i++) {
+            m_bytecode.m_names.emplace_back(ast.symbolName(i));
+        }
+
+        m_temporaries = static_cast<uint32_t>(ast.symbolCount());
+        m_top = m_temporaries;
+        m_bytecode.m_registers = m_top;
+    }
+
+    bool enter(const Ast& ast, NodeId id) override
+    {
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::READ:
+        case AstNode::Kind::ASSIGN:
+            m_bytecode.m_statements++;
+            break;
+        case AstNode::Kind::WRITE:
+            m_bytecode.m_statements++;
+            m_writeBase = m_top;
+            break;
+        case AstNode::Kind::EXPR:
+            m_exprs.push_back(target(ast));
+            break;
+        case AstNode::Kind::IDENTIFIER:
+            if (ast.node(m_parents.back()).kind == AstNode::Kind::READ) {
+                emit(Opcode::READ, node.value);
+            } else if (isFirst(ast, id)) {
+                emit(Opcode::MOVE, m_exprs.back(), node.value);
+            } else {
+                emit(node.op == AstNode::Op::PLUS ? Opcode::ADD : Opcode::SUB,
+                     m_exprs.back(), m_exprs.back(), node.value);
+            }
+            break;
+        case AstNode::Kind::INTEGER:
+            if (isFirst(ast, id)) {
+                emit(Opcode::LOADK, m_exprs.back(), constant(ast.integer(id)));
+            } else {
+                emit(node.op == AstNode::Op::PLUS ? Opcode::ADDK : Opcode::SUBK,
+                     m_exprs.back(), m_exprs.back(),
+                     constant(ast.integer(id)));
+            }
+            break;
+        default:
+            break;
+        }
+
+        m_parents.push_back(id);
+        return true;
+    }
+
+    void leave(const Ast& ast, NodeId id) override
+    {
+        m_parents.pop_back();
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::PROGRAM:
+            emit(Opcode::HALT);
+            break;
+        case AstNode::Kind::WRITE:
+            // Each expression was evaluated into the next register up.
+            emit(Opcode::WRITE, m_writeBase, m_top - m_writeBase);
+            m_top = m_temporaries;
+            break;
+        case AstNode::Kind::ASSIGN:
+            // The expression's last instruction computes its value, so have
+            // it store straight into the variable rather than add a MOVE.
+            m_bytecode.m_code.back().a = node.value;
+            m_top = m_temporaries;
+            break;
+        case AstNode::Kind::EXPR:
+            m_finished = m_exprs.back();
+            m_exprs.pop_back();
+            break;
+        case AstNode::Kind::GROUP:
+            if (m_finished != m_exprs.back()) {
+                emit(node.op == AstNode::Op::PLUS ? Opcode::ADD : Opcode::SUB,
+                     m_exprs.back(), m_exprs.back(), m_finished);
+                m_top--;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    /**
+     * @brief target picks the register for an expression being entered.
+     */
+    uint32_t target(const Ast& ast)
+    {
+        NodeId parent = m_parents.back();
+
+        // A first operand in parentheses is computed in place.
+        if (ast.node(parent).kind == AstNode::Kind::GROUP &&
+            ast.node(m_parents[m_parents.size() - 2]).firstChild == parent) {
+            return m_exprs.back();
+        }
+
+        m_bytecode.m_registers = std::max(m_bytecode.m_registers, m_top + 1);
+        return m_top++;
+    }
+
+    /**
+     * @brief isFirst returns whether a node is the first operand of the
+     * expression it's in, which is the innermost node being visited.
+     */
+    bool isFirst(const Ast& ast, NodeId id) const
+    {
+        return ast.node(m_parents.back()).firstChild == id;
+    }
+
+    uint32_t constant(int64_t value)
+    {
+        auto found = m_constants.find(value);
+        if (found != m_constants.end()) {
+            return found->second;
+        }
+
+        auto index = static_cast<uint32_t>(m_bytecode.m_constants.size());
+        m_bytecode.m_constants.push_back(value);
+        m_constants.emplace(value, index);
+
+        return index;
+    }
+
+    void emit(Opcode opcode, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0)
+    {
+        std::vector<Instruction>& code = m_bytecode.m_code;
+
+        // An expression's first operand is loaded into the target and then
+        // added to. Fold the load into the addition where the operands allow.
+        bool arithmetic = opcode == Opcode::ADD || opcode == Opcode::SUB ||
+                          opcode == Opcode::ADDK || opcode == Opcode::SUBK;
+
+        if (arithmetic && b == a && !code.empty() && code.back().a == a) {
+            Instruction& previous = code.back();
+
+            if (previous.opcode == Opcode::MOVE) {
+                previous = Instruction{opcode, a, previous.b, c};
+                return;
+            }
+
+            if (previous.opcode == Opcode::LOADK && opcode == Opcode::ADD) {
+                previous = Instruction{Opcode::ADDK, a, c, previous.b};
+                return;
+            }
+        }
+
+        code.push_back(Instruction{opcode, a, b, c});
+    }
+
+    Bytecode& m_bytecode;
+
+    // Where the temporaries start, and the first free one.
+    uint32_t m_temporaries;
+    uint32_t m_top;
+
+    // The nodes being visited, and the targets of the expressions among them.
+    std::vector<NodeId> m_parents;
+    std::vector<uint32_t> m_exprs;
+
+    // The target of the expression that was just left.
+    uint32_t m_finished;
+
+    uint32_t m_writeBase;
+
+    std::unordered_map<int64_t, uint32_t> m_constants;
+};
+
+Bytecode Bytecode::compile(const Ast& ast)
+{
+    Bytecode bytecode;
+    BytecodeCompiler compiler{bytecode};
+
+    compiler.start(ast);
+
+    if (ast.root() == NO_NODE) {
+        bytecode.m_code.push_back(Instruction{Opcode::HALT, 0, 0, 0});
+    } else {
+        ast.walk(compiler);
+    }
+
+    return bytecode;
+}
+
+void Bytecode::disassemble(std::ostream& stream) const
+{
+    static const char* NAMES[] = {"LOADK", "MOVE", "ADD",   "SUB", "ADDK",
+                                  "SUBK",  "READ", "WRITE", "HALT"};
+
+    // Variables are shown by name and temporaries as t<n>.
+    auto reg = [this](uint32_t index) {
+        return index < variables() ? name(index)
+                                   : "t" + std::to_string(index - variables());
+    };
+
+    for (size_t i = 0; i < m_code.size(); i++) {
+        const Instruction& instruction = m_code[i];
+
+        stream << std::setw(6) << i << "  ";
+
+        if (instruction.opcode != Opcode::HALT) {
+            stream << std::left << std::setw(6);
+        }
+        stream << NAMES[static_cast<int>(instruction.opcode)] << std::right;
+
+        switch (instruction.opcode) {
+        case Opcode::LOADK:
+            stream << "  " << reg(instruction.a) << ", "
+                   << m_constants[instruction.b];
+            break;
+        case Opcode::MOVE:
+            stream << "  " << reg(instruction.a) << ", " << reg(instruction.b);
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+            stream << "  " << reg(instruction.a) << ", " << reg(instruction.b)
+                   << ", " << reg(instruction.c);
+            break;
+        case Opcode::ADDK:
+        case Opcode::SUBK:
+            stream << "  " << reg(instruction.a) << ", " << reg(instruction.b)
+                   << ", " << m_constants[instruction.c];
+            break;
+        case Opcode::READ:
+            stream << "  " << reg(instruction.a);
+            break;
+        case Opcode::WRITE:
+            stream << "  " << reg(instruction.a) << ", " << instruction.b;
+            break;
+        case Opcode::HALT:
+            break;
+        }
+
+        stream << "\n";
+    }
+}
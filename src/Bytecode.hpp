@@ -0,0 +1,117 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include "Ast.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Opcode is the operation of an {@code Instruction}. R(x) is register
+ * x and K(x) is constant x. Arithmetic wraps around on overflow.
+ */
+enum class Opcode : uint8_t
+{
+    // R(a) = K(b)
+    LOADK,
+    // R(a) = R(b)
+    MOVE,
+    // R(a) = R(b) + R(c)
+    ADD,
+    // R(a) = R(b) - R(c)
+    SUB,
+    // R(a) = R(b) + K(c)
+    ADDK,
+    // R(a) = R(b) - K(c)
+    SUBK,
+    // Reads an integer from the input into R(a).
+    READ,
+    // Writes R(a) to R(a + b - 1) to the output on one line.
+    WRITE,
+    // Stops the program.
+    HALT,
+};
+
+struct Instruction
+{
+    Opcode opcode;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+/**
+ * @brief Bytecode is a program lowered for the {@code Vm}: a flat list of
+ * register instructions ending in HALT, and a pool of constants.
+ *
+ * Every variable has a register of its own, numbered by symbol ID, so
+ * registers [0, variables) hold the variables. The registers after those are
+ * temporaries for expressions.
+ */
+class Bytecode
+{
+public:
+    /**
+     * @brief compile lowers a parsed program. The tree has to be free of
+     * syntax errors.
+     */
+    static Bytecode compile(const Ast& ast);
+
+    const std::vector<Instruction>& code() const
+    {
+        return m_code;
+    }
+
+    const std::vector<int64_t>& constants() const
+    {
+        return m_constants;
+    }
+
+    // Total registers needed, variables and temporaries.
+    uint32_t registers() const
+    {
+        return m_registers;
+    }
+
+    uint32_t variables() const
+    {
+        return static_cast<uint32_t>(m_names.size());
+    }
+
+    /**
+     * @brief name returns the spelling of the variable in a register.
+     */
+    const std::string& name(uint32_t variable) const
+    {
+        return m_names[variable];
+    }
+
+    /**
+     * @brief statements returns how many statements the program was lowered
+     * from.
+     */
+    size_t statements() const
+    {
+        return m_statements;
+    }
+
+    /**
+     * @brief disassemble writes one instruction per line.
+     */
+    void disassemble(std::ostream& stream) const;
+
+private:
+    friend class BytecodeCompiler;
+    friend class ResultCodec;
+
+    std::vector<Instruction> m_code;
+    std::vector<int64_t> m_constants;
+    uint32_t m_registers = 0;
+
+    std::vector<std::string> m_names;
+    size_t m_statements = 0;
+};
+
+#endif // BYTECODE_HPP
@@ -0,0 +1,96 @@
+#ifndef CHARCLASS_HPP
+#define CHARCLASS_HPP
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief CharClass is the lexical class of a single source byte. The first
+ * byte of a token decides which kind of token is being read.
+ */
+enum class CharClass : uint8_t
+{
+    OTHER,
+    WHITESPACE,
+    LETTER,
+    DIGIT,
+    UNDERSCORE,
+    LPAREN,
+    RPAREN,
+    SYMBOL,
+    COLON,
+    EQUALS,
+    OP,
+};
+
+namespace detail
+{
+constexpr std::array<CharClass, 256> makeCharClasses()
+{
+    std::array<CharClass, 256> classes{};
+
+    for (int c = 0; c < 256; c++) {
+        classes[c] = CharClass::OTHER;
+    }
+
+    // The same set iswspace accepts in the C locale.
+    classes[' '] = CharClass::WHITESPACE;
+    classes['\t'] = CharClass::WHITESPACE;
+    classes['\n'] = CharClass::WHITESPACE;
+    classes['\v'] = CharClass::WHITESPACE;
+    classes['\f'] = CharClass::WHITESPACE;
+    classes['\r'] = CharClass::WHITESPACE;
+
+    for (int c = 'A'; c <= 'Z'; c++) {
+        classes[c] = CharClass::LETTER;
+        classes[c - 'A' + 'a'] = CharClass::LETTER;
+    }
+
+    for (int c = '0'; c <= '9'; c++) {
+        classes[c] = CharClass::DIGIT;
+    }
+
+    classes['_'] = CharClass::UNDERSCORE;
+    classes['('] = CharClass::LPAREN;
+    classes[')'] = CharClass::RPAREN;
+    classes[','] = CharClass::SYMBOL;
+    classes[';'] = CharClass::SYMBOL;
+    classes[':'] = CharClass::COLON;
+    classes['='] = CharClass::EQUALS;
+    classes['+'] = CharClass::OP;
+    classes['-'] = CharClass::OP;
+
+    return classes;
+}
+} // namespace detail
+
+// Built at compile time, indexed by the unsigned value of a source byte.
+constexpr std::array<CharClass, 256> CHAR_CLASSES = detail::makeCharClasses();
+
+constexpr CharClass classify(char c)
+{
+    return CHAR_CLASSES[static_cast<unsigned char>(c)];
+}
+
+/**
+ * @brief isIdentifierTail returns whether a byte can continue an identifier.
+ * Identifiers must start with a letter, but may continue with letters, digits
+ * and underscores.
+ */
+constexpr bool isIdentifierTail(char c)
+{
+    CharClass charClass = classify(c);
+    return charClass == CharClass::LETTER || charClass == CharClass::DIGIT ||
+           charClass == CharClass::UNDERSCORE;
+}
+
+/**
+ * @brief foldCase upper cases ASCII letters and leaves everything else as is.
+ * Unlike ::toupper it doesn't depend on the locale.
+ */
+constexpr char foldCase(char c)
+{
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+#endif // CHARCLASS_HPP
@@ -0,0 +1,124 @@
+#include "ChunkReader.hpp"
+
+#include <cerrno>
+#include <iostream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <unistd.h>
+#define HAVE_POLL 1
+
+namespace
+{
+// How long a read waits before checking whether to stop, in milliseconds.
+const int STOP_CHECK_INTERVAL = 100;
+} // namespace
+#else
+#define HAVE_POLL 0
+#endif
+
+ChunkReader::ChunkReader(int fd, size_t chunkSize, size_t maxChunks)
+    : m_fd{fd}
+    , m_chunkSize{chunkSize}
+    , m_maxChunks{maxChunks}
+    , m_bytesRead{0}
+    , m_ended{false}
+    , m_stopping{false}
+    , m_thread{&ChunkReader::run, this}
+{}
+
+ChunkReader::~ChunkReader()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_space.notify_all();
+
+    m_thread.join();
+}
+
+bool ChunkReader::next(std::string& buffer)
+{
+    std::string chunk;
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_ready.wait(lock, [this] { return !m_chunks.empty() || m_ended; });
+
+        if (m_chunks.empty()) {
+            return false;
+        }
+
+        chunk = std::move(m_chunks.front());
+        m_chunks.pop_front();
+    }
+    m_space.notify_one();
+
+    m_bytesRead += chunk.size();
+    buffer += chunk;
+    return true;
+}
+
+void ChunkReader::run()
+{
+    while (true) {
+        std::string chunk(m_chunkSize, '\0');
+        chunk.resize(read(&chunk[0], chunk.size()));
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+
+        if (chunk.empty()) {
+            m_ended = true;
+            m_ready.notify_one();
+            return;
+        }
+
+        // Hold back until there's room, so the producer is held back too.
+        m_space.wait(lock, [this] {
+            return m_chunks.size() < m_maxChunks || m_stopping;
+        });
+
+        if (m_stopping) {
+            return;
+        }
+
+        m_chunks.push_back(std::move(chunk));
+        m_ready.notify_one();
+    }
+}
+
+size_t ChunkReader::read(char* data, size_t size)
+{
+#if HAVE_POLL
+    // Wait for input a while at a time, so a stream that never ends doesn't
+    // keep the destructor waiting.
+    pollfd descriptor{m_fd, POLLIN, 0};
+
+    while (!m_stopping) {
+        int ready = ::poll(&descriptor, 1, STOP_CHECK_INTERVAL);
+
+        if (ready < 0 && errno != EINTR) {
+            return 0;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t count = ::read(m_fd, data, size);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        return count < 0 ? 0 : static_cast<size_t>(count);
+    }
+
+    return 0;
+#else
+    // The standard input is all there is to read, and a read can't be cut
+    // short, so wait for the whole chunk.
+    std::cin.read(data, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(std::cin.gcount());
+#endif
+}
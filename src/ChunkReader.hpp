@@ -0,0 +1,88 @@
+#ifndef CHUNKREADER_HPP
+#define CHUNKREADER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief ChunkReader reads a stream, such as a pipe, on a thread of its own
+ * and hands it over in chunks of at most a fixed size. A chunk is handed over
+ * as soon as it's read, without waiting for it to fill, so a consumer sees
+ * input as soon as the producer writes it.
+ *
+ * Only a few chunks are read ahead. Once they're waiting, the reader stops
+ * reading until one is taken, which leaves a pipe's writer blocked until the
+ * consumer catches up. Memory use is bounded however long the stream is.
+ */
+class ChunkReader
+{
+public:
+    /**
+     * @param fd the file descriptor to read, 0 for the standard input. Where
+     * there are no file descriptors the standard input is read instead.
+     * @param chunkSize the most read at a time
+     * @param maxChunks how many chunks may be waiting to be taken
+     */
+    explicit ChunkReader(int fd,
+                         size_t chunkSize = 64 << 10,
+                         size_t maxChunks = 4);
+
+    /**
+     * @brief Stops reading, even if the stream hasn't ended.
+     */
+    ~ChunkReader();
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    /**
+     * @brief next waits for the next chunk and appends it to a buffer.
+     * @return false once the stream has ended and every chunk has been taken
+     */
+    bool next(std::string& buffer);
+
+    /**
+     * @brief bytesRead returns how much of the stream has been taken so far.
+     */
+    uint64_t bytesRead() const
+    {
+        return m_bytesRead;
+    }
+
+private:
+    void run();
+
+    /**
+     * @brief read reads whatever is available, up to size bytes, waiting if
+     * there's nothing.
+     * @return how much was read, 0 at the end of the stream or on stopping
+     */
+    size_t read(char* data, size_t size);
+
+    int m_fd;
+    size_t m_chunkSize;
+    size_t m_maxChunks;
+
+    uint64_t m_bytesRead;
+
+    // Guards the chunks and m_ended. The reader waits on m_space while
+    // m_maxChunks are waiting, and next() waits on m_ready while none are.
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::condition_variable m_space;
+    std::deque<std::string> m_chunks;
+    bool m_ended;
+
+    std::atomic<bool> m_stopping;
+
+    // Last, so everything it uses exists before it starts.
+    std::thread m_thread;
+};
+
+#endif // CHUNKREADER_HPP
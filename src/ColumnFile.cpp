@@ -0,0 +1,132 @@
+#include "ColumnFile.hpp"
+
+#include "ResultCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+// "COLUMNAR" read as a little endian number. A file written on a machine of
+// the other byte order doesn't match.
+const uint64_t MAGIC = 0x52414E4D554C4F43ull;
+
+// Bumped whenever the layout changes.
+const uint32_t VERSION = 1;
+
+struct Header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t columns;
+    uint64_t rows;
+};
+} // namespace
+
+ColumnFile::ColumnFile()
+    : m_columns{0}
+    , m_rows{0}
+    , m_values{nullptr}
+{}
+
+bool ColumnFile::open(const std::string& fileName)
+{
+    close();
+
+    if (!m_file.open(fileName) || m_file.size() < sizeof(Header)) {
+        close();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+
+    // The values have to fill the rest of the file exactly. Dividing rather
+    // than multiplying keeps a damaged header from overflowing.
+    uint64_t values = (m_file.size() - sizeof(Header)) / sizeof(int64_t);
+    bool sized = (m_file.size() - sizeof(Header)) % sizeof(int64_t) == 0 &&
+                 (header.columns == 0
+                      ? values == 0
+                      : values % header.columns == 0 &&
+                            values / header.columns == header.rows);
+
+    if (header.magic != MAGIC || header.version != VERSION || !sized) {
+        close();
+        return false;
+    }
+
+    // Mappings are page aligned and the header is a multiple of eight bytes
+    // long, so the values can be read in place.
+    m_columns = header.columns;
+    m_rows = header.rows;
+    m_values = reinterpret_cast<const int64_t*>(m_file.data() + sizeof(Header));
+    return true;
+}
+
+void ColumnFile::close()
+{
+    m_file.close();
+    m_columns = 0;
+    m_rows = 0;
+    m_values = nullptr;
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    if (m_stream.is_open()) {
+        m_stream.close();
+        std::remove(m_temporary.c_str());
+    }
+}
+
+bool ColumnWriter::open(const std::string& fileName,
+                        size_t columns,
+                        uint64_t rows)
+{
+    m_fileName = fileName;
+    m_temporary = ResultCache::temporaryName(fileName);
+    m_rows = rows;
+
+    m_stream.open(m_temporary, std::ios::binary | std::ios::trunc);
+    if (!m_stream.is_open()) {
+        return false;
+    }
+
+    Header header{MAGIC, VERSION, static_cast<uint32_t>(columns), rows};
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Size the file up front, so columns can be written in any order.
+    if (columns != 0 && rows != 0) {
+        int64_t last = 0;
+        m_stream.seekp(static_cast<std::streamoff>(
+            sizeof(Header) + (columns * rows - 1) * sizeof(int64_t)));
+        m_stream.write(reinterpret_cast<const char*>(&last), sizeof(last));
+    }
+
+    return static_cast<bool>(m_stream);
+}
+
+void ColumnWriter::write(size_t column,
+                         uint64_t row,
+                         const int64_t* values,
+                         size_t count)
+{
+    m_stream.seekp(static_cast<std::streamoff>(
+        sizeof(Header) + (column * m_rows + row) * sizeof(int64_t)));
+    m_stream.write(reinterpret_cast<const char*>(values),
+                   static_cast<std::streamsize>(count * sizeof(int64_t)));
+}
+
+bool ColumnWriter::close()
+{
+    bool written = static_cast<bool>(m_stream.flush());
+    m_stream.close();
+
+    if (!written ||
+        std::rename(m_temporary.c_str(), m_fileName.c_str()) != 0) {
+        std::remove(m_temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef COLUMNFILE_HPP
+#define COLUMNFILE_HPP
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief ColumnFile is a table of 64-bit integers stored a column at a time,
+ * the input and output of running a program over many rows with
+ * {@code BatchVm}.
+ *
+ * The file is a header holding the number of columns and rows, followed by
+ * each column in turn as an array of little endian integers, so every value
+ * of a column is contiguous. It's mapped rather than read, and columns are
+ * served straight out of the mapping.
+ */
+class ColumnFile
+{
+public:
+    ColumnFile();
+
+    /**
+     * @brief open maps a column file, if it's one and is intact.
+     * @return false if it isn't, in which case it's closed
+     */
+    bool open(const std::string& fileName);
+
+    void close();
+
+    size_t columns() const
+    {
+        return m_columns;
+    }
+
+    uint64_t rows() const
+    {
+        return m_rows;
+    }
+
+    /**
+     * @brief column returns the values of a column, one per row.
+     */
+    const int64_t* column(size_t index) const
+    {
+        return m_values + index * m_rows;
+    }
+
+private:
+    MappedFile m_file;
+
+    size_t m_columns;
+    uint64_t m_rows;
+
+    // A view of the columns in the mapping.
+    const int64_t* m_values;
+};
+
+/**
+ * @brief ColumnWriter writes a {@code ColumnFile} whose size is known up
+ * front, in pieces of columns given in any order. The file is written under
+ * a temporary name and renamed into place when it's closed, so readers never
+ * see a partial file.
+ */
+class ColumnWriter
+{
+public:
+    ColumnWriter() = default;
+
+    ColumnWriter(const ColumnWriter&) = delete;
+    ColumnWriter& operator=(const ColumnWriter&) = delete;
+
+    /**
+     * @brief Abandons a file that was opened but never closed.
+     */
+    ~ColumnWriter();
+
+    /**
+     * @brief open starts writing a file of the given size.
+     * @return false if it couldn't be created
+     */
+    bool open(const std::string& fileName, size_t columns, uint64_t rows);
+
+    /**
+     * @brief write stores {@code count} values of a column, starting at a
+     * row.
+     */
+    void write(size_t column,
+               uint64_t row,
+               const int64_t* values,
+               size_t count);
+
+    /**
+     * @brief close finishes the file and moves it into place.
+     * @return false if any of it couldn't be written
+     */
+    bool close();
+
+private:
+    std::ofstream m_stream;
+    std::string m_fileName;
+    std::string m_temporary;
+
+    uint64_t m_rows = 0;
+};
+
+#endif // COLUMNFILE_HPP
@@ -0,0 +1,327 @@
+#include "Dataflow.hpp"
+
+#include <algorithm>
+
+namespace
+{
+size_t wordCount(size_t size)
+{
+    return (size + 63) / 64;
+}
+
+inline unsigned int popCount(uint64_t word)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned int>(__popcnt64(word));
+#else
+    return static_cast<unsigned int>(__builtin_popcountll(word));
+#endif
+}
+
+/**
+ * @brief Liveness finds the assignments whose values are never read. Facts
+ * are the live variables, flowing backward from none at the end.
+ */
+class Liveness : public Dataflow::Problem
+{
+public:
+    Liveness(const Ast& ast, size_t statements)
+        : m_ast{ast}
+        , m_dead(statements, false)
+    {}
+
+    Dataflow::Direction direction() const override
+    {
+        return Dataflow::Direction::BACKWARD;
+    }
+
+    void transfer(const Dataflow& flow,
+                  size_t statement,
+                  BitSet& facts) override
+    {
+        // A dead assignment is as good as gone, reads and all. READs stay.
+        if (m_ast.node(flow.statement(statement)).kind ==
+                AstNode::Kind::ASSIGN &&
+            !facts.test(flow.writes(statement).begin()->variable)) {
+            m_dead[statement] = true;
+            return;
+        }
+
+        for (const Dataflow::Access& write : flow.writes(statement)) {
+            facts.reset(write.variable);
+        }
+        for (const Dataflow::Access& read : flow.reads(statement)) {
+            facts.set(read.variable);
+        }
+    }
+
+    const std::vector<bool>& dead() const
+    {
+        return m_dead;
+    }
+
+private:
+    const Ast& m_ast;
+
+    std::vector<bool> m_dead;
+};
+
+/**
+ * @brief Initialization finds reads of variables nothing has been stored in.
+ * Facts are the variables that have, flowing forward from none.
+ */
+class Initialization : public Dataflow::Problem
+{
+public:
+    Initialization(const Ast& ast, const LineIndex& lines)
+        : m_ast{ast}
+        , m_lines{lines}
+        , m_reported(ast.symbolCount())
+    {}
+
+    Dataflow::Direction direction() const override
+    {
+        return Dataflow::Direction::FORWARD;
+    }
+
+    void transfer(const Dataflow& flow,
+                  size_t statement,
+                  BitSet& facts) override
+    {
+        for (const Dataflow::Access& read : flow.reads(statement)) {
+            if (!facts.test(read.variable) &&
+                !m_reported.test(read.variable)) {
+                m_reported.set(read.variable);
+                report(read);
+            }
+        }
+
+        for (const Dataflow::Access& write : flow.writes(statement)) {
+            facts.set(write.variable);
+        }
+    }
+
+    std::vector<Diagnostic>& diagnostics()
+    {
+        return m_diagnostics;
+    }
+
+private:
+    void report(const Dataflow::Access& read)
+    {
+        uint32_t offset = m_ast.node(read.node).offset;
+        SourcePosition position = m_lines.position(offset);
+
+        m_diagnostics.push_back(Diagnostic::warning(
+            std::string{m_ast.symbolName(read.variable)} +
+                " is read before it's assigned",
+            position.lineNumber, position.columnNumber, offset));
+    }
+
+    const Ast& m_ast;
+    const LineIndex& m_lines;
+
+    BitSet m_reported;
+    std::vector<Diagnostic> m_diagnostics;
+};
+} // namespace
+
+BitSet::BitSet(size_t size)
+    : m_words(wordCount(size), 0)
+    , m_size{size}
+{}
+
+void BitSet::resize(size_t size)
+{
+    m_words.assign(wordCount(size), 0);
+    m_size = size;
+}
+
+void BitSet::setAll()
+{
+    std::fill(m_words.begin(), m_words.end(), ~uint64_t{0});
+
+    // Bits past the end stay clear, so counts and comparisons hold.
+    if (m_size % 64 != 0) {
+        m_words.back() = (uint64_t{1} << (m_size % 64)) - 1;
+    }
+}
+
+void BitSet::clearAll()
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+BitSet& BitSet::operator|=(const BitSet& other)
+{
+    for (size_t i = 0; i < m_words.size(); i++) {
+        m_words[i] |= other.m_words[i];
+    }
+
+    return *this;
+}
+
+BitSet& BitSet::operator&=(const BitSet& other)
+{
+    for (size_t i = 0; i < m_words.size(); i++) {
+        m_words[i] &= other.m_words[i];
+    }
+
+    return *this;
+}
+
+BitSet& BitSet::operator-=(const BitSet& other)
+{
+    for (size_t i = 0; i < m_words.size(); i++) {
+        m_words[i] &= ~other.m_words[i];
+    }
+
+    return *this;
+}
+
+size_t BitSet::count() const
+{
+    size_t count = 0;
+
+    for (uint64_t word : m_words) {
+        count += popCount(word);
+    }
+
+    return count;
+}
+
+Dataflow::Dataflow(const Ast& ast)
+    : m_variables{ast.symbolCount()}
+    , m_readStarts{0}
+    , m_writeStarts{0}
+{
+    if (ast.root() == NO_NODE) {
+        return;
+    }
+
+    // Expressions nest inside GROUPs. Their identifiers are found in order
+    // by following siblings, keeping a stack of where to carry on from after
+    // each nested expression.
+    std::vector<NodeId> resume;
+
+    auto read = [&](NodeId first) {
+        NodeId id = first;
+
+        while (id != NO_NODE || !resume.empty()) {
+            if (id == NO_NODE) {
+                id = resume.back();
+                resume.pop_back();
+                continue;
+            }
+
+            const AstNode& node = ast.node(id);
+
+            if (node.kind == AstNode::Kind::IDENTIFIER) {
+                m_reads.push_back(Access{node.value, id});
+            }
+
+            if (node.firstChild != NO_NODE) {
+                resume.push_back(node.nextSibling);
+                id = node.firstChild;
+            } else {
+                id = node.nextSibling;
+            }
+        }
+    };
+
+    for (NodeId statement = ast.node(ast.root()).firstChild;
+         statement != NO_NODE; statement = ast.node(statement).nextSibling) {
+        const AstNode& node = ast.node(statement);
+
+        switch (node.kind) {
+        case AstNode::Kind::ASSIGN:
+        case AstNode::Kind::WRITE:
+            // Every child is an expression; an ASSIGN only has the one.
+            read(node.firstChild);
+            if (node.kind == AstNode::Kind::ASSIGN) {
+                m_writes.push_back(Access{node.value, statement});
+            }
+            break;
+        case AstNode::Kind::READ:
+            for (NodeId child = node.firstChild; child != NO_NODE;
+                 child = ast.node(child).nextSibling) {
+                m_writes.push_back(Access{ast.node(child).value, child});
+            }
+            break;
+        default:
+            break;
+        }
+
+        m_statements.push_back(statement);
+        m_readStarts.push_back(static_cast<uint32_t>(m_reads.size()));
+        m_writeStarts.push_back(static_cast<uint32_t>(m_writes.size()));
+    }
+}
+
+void Dataflow::solve(Problem& problem) const
+{
+    BitSet facts{m_variables};
+    problem.boundary(facts);
+
+    if (problem.direction() == Direction::FORWARD) {
+        for (size_t i = 0; i < m_statements.size(); i++) {
+            problem.transfer(*this, i, facts);
+        }
+    } else {
+        for (size_t i = m_statements.size(); i-- > 0;) {
+            problem.transfer(*this, i, facts);
+        }
+    }
+}
+
+size_t eliminateDeadStores(Ast& ast)
+{
+    if (ast.root() == NO_NODE) {
+        return 0;
+    }
+
+    Dataflow flow{ast};
+    Liveness liveness{ast, flow.statementCount()};
+    flow.solve(liveness);
+
+    // Relink the statements that are left.
+    const std::vector<bool>& dead = liveness.dead();
+    AstNode& program = ast.node(ast.root());
+    NodeId last = NO_NODE;
+    size_t removed = 0;
+
+    program.firstChild = NO_NODE;
+
+    for (size_t i = 0; i < flow.statementCount(); i++) {
+        NodeId statement = flow.statement(i);
+
+        if (dead[i]) {
+            removed++;
+            continue;
+        }
+
+        if (last == NO_NODE) {
+            program.firstChild = statement;
+        } else {
+            ast.node(last).nextSibling = statement;
+        }
+        last = statement;
+    }
+
+    if (last != NO_NODE) {
+        ast.node(last).nextSibling = NO_NODE;
+    }
+    program.lastChild = last;
+
+    return removed;
+}
+
+std::vector<Diagnostic> findUninitializedReads(const Ast& ast,
+                                               const LineIndex& lines)
+{
+    Dataflow flow{ast};
+    Initialization initialization{ast, lines};
+    flow.solve(initialization);
+
+    return std::move(initialization.diagnostics());
+}
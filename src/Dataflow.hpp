@@ -0,0 +1,232 @@
+#ifndef DATAFLOW_HPP
+#define DATAFLOW_HPP
+
+#include "Ast.hpp"
+#include "Diagnostics.hpp"
+#include "LineIndex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief BitSet is a fixed size set of small integers, packed 64 to a word so
+ * that whole sets are cleared, filled and combined a word at a time.
+ */
+class BitSet
+{
+public:
+    BitSet() = default;
+
+    /**
+     * @brief Creates an empty set of integers below {@code size}.
+     */
+    explicit BitSet(size_t size);
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * @brief resize changes the range of the set. It's left empty.
+     */
+    void resize(size_t size);
+
+    bool test(size_t bit) const
+    {
+        return (m_words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    void set(size_t bit)
+    {
+        m_words[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+
+    void reset(size_t bit)
+    {
+        m_words[bit / 64] &= ~(uint64_t{1} << (bit % 64));
+    }
+
+    void setAll();
+    void clearAll();
+
+    BitSet& operator|=(const BitSet& other);
+    BitSet& operator&=(const BitSet& other);
+
+    /**
+     * @brief operator-= removes every member of another set of the same size.
+     */
+    BitSet& operator-=(const BitSet& other);
+
+    bool operator==(const BitSet& other) const
+    {
+        return m_words == other.m_words;
+    }
+
+    size_t count() const;
+
+private:
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+};
+
+/**
+ * @brief Dataflow solves dataflow problems over the variables of a parsed
+ * program. Variables are the tree's symbol IDs, which are already dense, so a
+ * set of facts about them is a {@code BitSet}.
+ *
+ * Every statement's effects, the variables it reads and the ones it assigns,
+ * are gathered once into flat arrays. A program is a single straight line of
+ * statements with no branches, so there are no paths to merge: one sweep over
+ * the statements in the problem's direction is the solution, and it takes
+ * time linear in the size of the program. Each statement only touches the
+ * bits of the variables it mentions.
+ */
+class Dataflow
+{
+public:
+    enum class Direction
+    {
+        FORWARD,
+        BACKWARD,
+    };
+
+    /**
+     * @brief Access is a variable read or assigned by a statement, with the
+     * node that mentions it.
+     */
+    struct Access
+    {
+        uint32_t variable;
+        NodeId node;
+    };
+
+    /**
+     * @brief Range is the accesses of one statement.
+     */
+    struct Range
+    {
+        const Access* first;
+        const Access* last;
+
+        const Access* begin() const
+        {
+            return first;
+        }
+
+        const Access* end() const
+        {
+            return last;
+        }
+    };
+
+    /**
+     * @brief Problem is an analysis to solve: which way the facts flow, what
+     * they are at the start of the sweep, and how each statement changes
+     * them.
+     */
+    class Problem
+    {
+    public:
+        virtual ~Problem() = default;
+
+        virtual Direction direction() const = 0;
+
+        /**
+         * @brief boundary sets the facts at the start of the sweep: before
+         * the first statement going forward, after the last going backward.
+         * By default nothing holds.
+         */
+        virtual void boundary(BitSet& facts)
+        {
+            facts.clearAll();
+        }
+
+        /**
+         * @brief transfer turns the facts on one side of a statement into the
+         * facts on the other, in the direction of the sweep.
+         */
+        virtual void transfer(const Dataflow& flow,
+                              size_t statement,
+                              BitSet& facts) = 0;
+    };
+
+    explicit Dataflow(const Ast& ast);
+
+    size_t statementCount() const
+    {
+        return m_statements.size();
+    }
+
+    /**
+     * @brief statement returns the node of the statement at an index, in
+     * program order.
+     */
+    NodeId statement(size_t index) const
+    {
+        return m_statements[index];
+    }
+
+    size_t variableCount() const
+    {
+        return m_variables;
+    }
+
+    /**
+     * @brief reads returns the variables a statement reads, in source order.
+     * All of them are read before any are assigned.
+     */
+    Range reads(size_t index) const
+    {
+        return Range{m_reads.data() + m_readStarts[index],
+                     m_reads.data() + m_readStarts[index + 1]};
+    }
+
+    /**
+     * @brief writes returns the variables a statement assigns, in order.
+     */
+    Range writes(size_t index) const
+    {
+        return Range{m_writes.data() + m_writeStarts[index],
+                     m_writes.data() + m_writeStarts[index + 1]};
+    }
+
+    /**
+     * @brief solve sweeps a problem over every statement.
+     */
+    void solve(Problem& problem) const;
+
+private:
+    std::vector<NodeId> m_statements;
+    size_t m_variables;
+
+    // Statement i's accesses are [starts[i], starts[i + 1]).
+    std::vector<Access> m_reads;
+    std::vector<uint32_t> m_readStarts;
+    std::vector<Access> m_writes;
+    std::vector<uint32_t> m_writeStarts;
+};
+
+/**
+ * @brief eliminateDeadStores removes every assignment whose value is never
+ * written out, found by liveness: a variable is live where its current value
+ * may still be read. An assignment to a variable that isn't live after it is
+ * dead, and so are the reads it makes, so assignments that only feed dead
+ * ones go too. READs are kept, as they consume input.
+ *
+ * Removed statements are unlinked from the tree but stay in it.
+ * @return how many assignments were removed
+ */
+size_t eliminateDeadStores(Ast& ast);
+
+/**
+ * @brief findUninitializedReads warns of every variable that's read before
+ * anything is assigned to it or read into it. Such reads see zero. Each
+ * variable is only reported once, at its first such read.
+ * @param lines the positions of the source the tree was parsed from
+ */
+std::vector<Diagnostic> findUninitializedReads(const Ast& ast,
+                                               const LineIndex& lines);
+
+#endif // DATAFLOW_HPP
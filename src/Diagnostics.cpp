@@ -0,0 +1,62 @@
+#include "Diagnostics.hpp"
+
+#include <utility>
+
+Diagnostic::Diagnostic(std::string expected,
+                       std::string actual,
+                       size_t lineNumber,
+                       size_t columnNumber,
+                       size_t offset)
+    : expected{std::move(expected)}
+    , actual{std::move(actual)}
+    , lineNumber{lineNumber}
+    , columnNumber{columnNumber}
+    , offset{offset}
+{}
+
+Diagnostic Diagnostic::warning(std::string message,
+                               size_t lineNumber,
+                               size_t columnNumber,
+                               size_t offset)
+{
+    Diagnostic diagnostic;
+    diagnostic.lineNumber = lineNumber;
+    diagnostic.columnNumber = columnNumber;
+    diagnostic.offset = offset;
+    diagnostic.severity = Severity::WARNING;
+    diagnostic.message = std::move(message);
+    return diagnostic;
+}
+
+std::ostream& operator<<(std::ostream& stream, const Diagnostic& diagnostic)
+{
+    if (diagnostic.severity == Diagnostic::Severity::WARNING) {
+        stream << "Warning: " << diagnostic.message;
+    } else {
+        stream << "Expected " << diagnostic.expected << ", but found "
+               << diagnostic.actual;
+    }
+
+    return stream << " at " << diagnostic.lineNumber << ":"
+                  << diagnostic.columnNumber;
+}
+
+void DiagnosticSink::report(Diagnostic diagnostic)
+{
+    if (diagnostic.severity == Diagnostic::Severity::ERROR) {
+        m_errorCount++;
+    }
+
+    if (m_handler) {
+        m_handler(diagnostic);
+        return;
+    }
+
+    m_diagnostics.push_back(std::move(diagnostic));
+}
+
+void DiagnosticSink::clear()
+{
+    m_diagnostics.clear();
+    m_errorCount = 0;
+}
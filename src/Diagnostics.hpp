@@ -0,0 +1,111 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Diagnostic describes a single problem and where it is. Errors are
+ * syntax errors: what the parser expected and what it found instead. Warnings
+ * are about programs that compile, and carry a message instead.
+ */
+struct Diagnostic
+{
+    enum class Severity : uint8_t
+    {
+        ERROR,
+        WARNING,
+    };
+
+    Diagnostic() = default;
+
+    /**
+     * @brief Creates an error: {@code expected} was expected, but
+     * {@code actual} was found.
+     */
+    Diagnostic(std::string expected,
+               std::string actual,
+               size_t lineNumber,
+               size_t columnNumber,
+               size_t offset);
+
+    /**
+     * @brief warning creates a warning with a message.
+     */
+    static Diagnostic warning(std::string message,
+                              size_t lineNumber,
+                              size_t columnNumber,
+                              size_t offset);
+
+    std::string expected;
+    std::string actual;
+    size_t lineNumber = 0;
+    size_t columnNumber = 0;
+
+    // Source offset of the token the problem was found at.
+    size_t offset = 0;
+
+    Severity severity = Severity::ERROR;
+    std::string message;
+};
+
+/**
+ * @brief operator<< prints an error as
+ * "Expected <expected>, but found <actual> at <line>:<column>", and a warning
+ * as "Warning: <message> at <line>:<column>".
+ */
+std::ostream& operator<<(std::ostream& stream, const Diagnostic& diagnostic);
+
+/**
+ * @brief DiagnosticSink collects the diagnostics reported while compiling, in
+ * the order they were found.
+ */
+class DiagnosticSink
+{
+public:
+    using Handler = std::function<void(const Diagnostic&)>;
+
+    /**
+     * @brief report adds a diagnostic. Only errors are counted by
+     * {@code errorCount}.
+     */
+    void report(Diagnostic diagnostic);
+
+    /**
+     * @brief setHandler has every diagnostic passed to a handler as soon as
+     * it's reported, instead of being kept. They're still counted.
+     */
+    void setHandler(Handler handler)
+    {
+        m_handler = std::move(handler);
+    }
+
+    const std::vector<Diagnostic>& diagnostics() const
+    {
+        return m_diagnostics;
+    }
+
+    bool hasErrors() const
+    {
+        return m_errorCount != 0;
+    }
+
+    size_t errorCount() const
+    {
+        return m_errorCount;
+    }
+
+    void clear();
+
+private:
+    std::vector<Diagnostic> m_diagnostics;
+    size_t m_errorCount = 0;
+
+    Handler m_handler;
+};
+
+#endif // DIAGNOSTICS_HPP
@@ -0,0 +1,385 @@
+#include "Document.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+namespace
+{
+// Segments per block. Blocks are split once they reach twice this.
+const size_t BLOCK_SIZE = 128;
+} // namespace
+
+Document::Document(std::string_view text)
+    : m_length{0}
+    , m_parser{m_tokenizer}
+{
+    // Start with a single empty segment, and edit the text into it.
+    m_blocks.emplace_back();
+    m_blocks[0].segments.emplace_back();
+    parse(m_blocks[0].segments[0], true, true);
+
+    edit(0, 0, text);
+}
+
+void Document::edit(size_t begin, size_t end, std::string_view replacement)
+{
+    m_lastEdit = EditStats{};
+
+    begin = std::min(begin, m_length);
+    end = std::min(std::max(end, begin), m_length);
+
+    Location at = locate(begin);
+    bool first = at.block == 0 && at.index == 0;
+
+    // Take the segments the edit touches out of the document, then keep
+    // taking segments until the text lines up with the segment after it
+    // again: it has to end with a semicolon, and if it starts the document it
+    // needs three of them.
+    std::string text;
+    size_t textEnd = at.start;
+    size_t taken = 0;
+    size_t semicolons = 0;
+
+    size_t block = at.block;
+    size_t index = at.index;
+
+    auto take = [&]() {
+        while (block < m_blocks.size() &&
+               index == m_blocks[block].segments.size()) {
+            block++;
+            index = 0;
+        }
+        if (block == m_blocks.size()) {
+            return false;
+        }
+
+        const std::string& segment = m_blocks[block].segments[index].text;
+        text += segment;
+        textEnd += segment.length();
+        semicolons += std::count(segment.begin(), segment.end(), ';');
+
+        index++;
+        taken++;
+        return true;
+    };
+
+    take();
+    while (textEnd < end) {
+        take();
+    }
+
+    semicolons -= std::count(text.begin() + (begin - at.start),
+                             text.begin() + (end - at.start), ';');
+    semicolons += std::count(replacement.begin(), replacement.end(), ';');
+    text.replace(begin - at.start, end - begin, replacement);
+
+    while ((!text.empty() && text.back() != ';') ||
+           (first && semicolons < 3)) {
+        if (!take()) {
+            break;
+        }
+    }
+
+    size_t lastBlock = std::min(block, m_blocks.size() - 1);
+
+    // Remove what was taken, and put the text back as new segments.
+    for (size_t b = at.block, i = at.index, remaining = taken; remaining > 0;
+         b++, i = 0) {
+        std::vector<Segment>& segments = m_blocks[b].segments;
+        size_t count = std::min(remaining, segments.size() - i);
+
+        segments.erase(segments.begin() + i, segments.begin() + i + count);
+        remaining -= count;
+    }
+
+    m_length = m_length - (end - begin) + replacement.length();
+
+    std::vector<std::string_view> pieces = split(text, first);
+    if (pieces.empty() && m_length == 0) {
+        pieces.emplace_back();
+    }
+
+    bool atEnd = at.index == m_blocks[at.block].segments.size();
+    for (size_t b = at.block + 1; atEnd && b <= lastBlock; b++) {
+        atEnd = m_blocks[b].segments.empty();
+    }
+    atEnd = atEnd && lastBlock + 1 == m_blocks.size();
+
+    std::vector<Segment> segments(pieces.size());
+    for (size_t i = 0; i < pieces.size(); i++) {
+        segments[i].text = pieces[i];
+        parse(segments[i], first && i == 0, atEnd && i + 1 == pieces.size());
+    }
+
+    std::vector<Segment>& target = m_blocks[at.block].segments;
+    target.insert(target.begin() + at.index,
+                  std::make_move_iterator(segments.begin()),
+                  std::make_move_iterator(segments.end()));
+
+    rebalance(at.block, lastBlock);
+
+    // If the old last segment went, the one now last has to be parsed again
+    // knowing that it's last.
+    Segment& last = m_blocks.back().segments.back();
+    if (!last.parsedAsLast) {
+        parse(last, m_blocks.size() == 1 && m_blocks[0].segments.size() == 1,
+              true);
+    }
+}
+
+std::string Document::text() const
+{
+    std::string text;
+    text.reserve(m_length);
+
+    for (const Block& block : m_blocks) {
+        for (const Segment& segment : block.segments) {
+            text += segment.text;
+        }
+    }
+
+    return text;
+}
+
+std::vector<Diagnostic> Document::diagnostics() const
+{
+    std::vector<Diagnostic> diagnostics;
+
+    size_t start = 0;
+    size_t line = 1;
+    size_t column = 1;
+
+    for (const Block& block : m_blocks) {
+        for (const Segment& segment : block.segments) {
+            // Move the errors from the segment's own positions to the text's.
+            for (Diagnostic diagnostic : segment.diagnostics) {
+                if (diagnostic.offset < segment.firstBreak ||
+                    segment.firstBreak == NO_BREAK) {
+                    diagnostic.columnNumber += column - 1;
+                }
+                diagnostic.lineNumber += line - 1;
+                diagnostic.offset += start;
+
+                diagnostics.push_back(std::move(diagnostic));
+            }
+
+            // Nothing after END is part of the program.
+            if (segment.foundEnd) {
+                return diagnostics;
+            }
+
+            place(segment, line, column);
+            start += segment.text.length();
+        }
+    }
+
+    return diagnostics;
+}
+
+void Document::buildAst(Ast& ast) const
+{
+    std::vector<const Ast*> trees;
+    std::vector<uint32_t> starts;
+    size_t start = 0;
+
+    // Nothing after END is part of the program.
+    bool foundEnd = false;
+
+    for (size_t b = 0; b < m_blocks.size() && !foundEnd; b++) {
+        for (const Segment& segment : m_blocks[b].segments) {
+            trees.push_back(&segment.ast);
+            starts.push_back(static_cast<uint32_t>(start));
+            start += segment.text.length();
+
+            foundEnd = segment.foundEnd;
+            if (foundEnd) {
+                break;
+            }
+        }
+    }
+
+    // The segments' symbols are already the document's.
+    std::vector<uint32_t> symbols(m_symbols.size());
+    std::iota(symbols.begin(), symbols.end(), 0);
+
+    ast.clear();
+    ast.addNode(AstNode::Kind::PROGRAM, trees[0]->node(0).offset);
+
+    std::vector<Ast::TreeRoom> rooms = ast.makeRoom(trees);
+
+    for (size_t i = 0; i < trees.size(); i++) {
+        rooms[i].offset = starts[i];
+        ast.copyTree(*trees[i], rooms[i], symbols);
+    }
+
+    ast.importSymbols(m_symbols);
+}
+
+size_t Document::segmentCount() const
+{
+    size_t count = 0;
+
+    for (const Block& block : m_blocks) {
+        count += block.segments.size();
+    }
+
+    return count;
+}
+
+Document::Location Document::locate(size_t offset) const
+{
+    size_t start = 0;
+
+    // The end of the text belongs to the last segment.
+    if (offset >= m_length) {
+        const Block& block = m_blocks.back();
+        return Location{m_blocks.size() - 1, block.segments.size() - 1,
+                        m_length - block.segments.back().text.length()};
+    }
+
+    for (size_t b = 0;; b++) {
+        const Block& block = m_blocks[b];
+
+        if (offset >= start + block.length) {
+            start += block.length;
+            continue;
+        }
+
+        for (size_t i = 0;; i++) {
+            size_t length = block.segments[i].text.length();
+
+            if (offset < start + length) {
+                return Location{b, i, start};
+            }
+            start += length;
+        }
+    }
+}
+
+std::vector<std::string_view> Document::split(std::string_view text,
+                                              bool first)
+{
+    std::vector<std::string_view> pieces;
+    size_t start = 0;
+    size_t needed = first ? 3 : 1;
+
+    while (start < text.length()) {
+        size_t cut = start;
+
+        for (size_t found = 0; found < needed; found++) {
+            size_t semicolon = text.find(';', cut);
+            if (semicolon == std::string_view::npos) {
+                cut = text.length();
+                break;
+            }
+            cut = semicolon + 1;
+        }
+
+        pieces.push_back(text.substr(start, cut - start));
+        start = cut;
+        needed = 1;
+    }
+
+    return pieces;
+}
+
+void Document::parse(Segment& segment, bool first, bool last)
+{
+    m_tokenizer.viewSource(segment.text.data(), 0, segment.text.length());
+
+    segment.foundEnd = m_parser.parsePart(first, last);
+    segment.parsedAsLast = last;
+
+    // Keep the tree, with its symbols moved to the document's table.
+    const Ast& tree = m_parser.ast();
+
+    std::vector<uint32_t> symbols;
+    for (size_t symbol = 0; symbol < tree.symbolCount(); symbol++) {
+        std::string_view name = tree.symbolName(symbol);
+        symbols.push_back(m_symbols.intern(name.data(), name.length()));
+    }
+
+    segment.ast.clear();
+    segment.ast.addNode(AstNode::Kind::PROGRAM, tree.node(tree.root()).offset);
+    segment.ast.copyTree(tree, segment.ast.makeRoom({&tree})[0], symbols);
+
+    segment.diagnostics = m_parser.diagnostics().diagnostics();
+
+    // Note where the line breaks are.
+    const std::string& text = segment.text;
+
+    segment.newlines =
+        static_cast<uint32_t>(std::count(text.begin(), text.end(), '\n'));
+
+    size_t firstBreak = text.find_first_of("\r\n");
+    size_t lastBreak = text.find_last_of("\r\n");
+
+    segment.firstBreak = firstBreak == std::string::npos
+                             ? NO_BREAK
+                             : static_cast<uint32_t>(firstBreak);
+    segment.lastBreak = lastBreak == std::string::npos
+                            ? NO_BREAK
+                            : static_cast<uint32_t>(lastBreak);
+
+    m_lastEdit.relexedBytes += text.length();
+    m_lastEdit.reparsedSegments++;
+}
+
+void Document::place(const Segment& segment, size_t& line, size_t& column)
+{
+    line += segment.newlines;
+
+    // The column restarts after the last line break.
+    if (segment.lastBreak != NO_BREAK) {
+        column = segment.text.length() - segment.lastBreak;
+    } else {
+        column += segment.text.length();
+    }
+}
+
+void Document::rebalance(size_t first, size_t last)
+{
+    for (size_t b = first; b <= last && b < m_blocks.size();) {
+        Block& block = m_blocks[b];
+
+        // Keep at least one block.
+        if (block.segments.empty() && m_blocks.size() > 1) {
+            m_blocks.erase(m_blocks.begin() + b);
+            if (b == last) {
+                break;
+            }
+            last--;
+            continue;
+        }
+
+        // Split oversized blocks into full blocks.
+        if (block.segments.size() >= 2 * BLOCK_SIZE) {
+            std::vector<Block> blocks((block.segments.size() - 1) / BLOCK_SIZE);
+
+            for (size_t i = 0; i < blocks.size(); i++) {
+                auto from = block.segments.begin() + (i + 1) * BLOCK_SIZE;
+                auto to = block.segments.begin() +
+                          std::min((i + 2) * BLOCK_SIZE, block.segments.size());
+
+                blocks[i].segments.assign(std::make_move_iterator(from),
+                                          std::make_move_iterator(to));
+            }
+            block.segments.resize(BLOCK_SIZE);
+
+            size_t added = blocks.size();
+            m_blocks.insert(m_blocks.begin() + b + 1,
+                            std::make_move_iterator(blocks.begin()),
+                            std::make_move_iterator(blocks.end()));
+            last += added;
+        }
+
+        Block& current = m_blocks[b];
+        current.length = 0;
+        for (const Segment& segment : current.segments) {
+            current.length += segment.text.length();
+        }
+
+        b++;
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef DOCUMENT_HPP
+#define DOCUMENT_HPP
+
+#include "Ast.hpp"
+#include "Diagnostics.hpp"
+#include "Parser.hpp"
+#include "SymbolTable.hpp"
+#include "Tokenizer.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Document is a program that is edited in place and kept parsed, for
+ * editors that want errors as the user types.
+ *
+ * The source is kept as segments split just after semicolons, the same way
+ * {@code ParallelParser} splits it: the first segment holds at least the
+ * first three semicolons, and every other segment is a single statement. No
+ * token spans a semicolon, and the parser is always between statements after
+ * one, so each segment is lexed and parsed on its own, with positions
+ * relative to its start. An edit re-lexes and re-parses only the segments it
+ * touches, extended to the next semicolon where the token stream lines up
+ * again; every other segment's tokens, tree and errors are reused as they
+ * are.
+ *
+ * Segments are grouped into blocks with their total length cached, so an
+ * edit finds its place by skipping whole blocks. The cost of an edit grows
+ * with the size of the statements it touches, plus a small amount per block.
+ */
+class Document
+{
+public:
+    explicit Document(std::string_view text = {});
+
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    /**
+     * @brief edit replaces the range [begin, end) of the text. Offsets past
+     * the end of the text are moved back to it.
+     */
+    void edit(size_t begin, size_t end, std::string_view replacement);
+
+    size_t length() const
+    {
+        return m_length;
+    }
+
+    /**
+     * @brief text returns the whole of the current text.
+     */
+    std::string text() const;
+
+    /**
+     * @brief diagnostics returns every syntax error in the program, the same
+     * as parsing the whole text with {@code Parser::parse} would.
+     */
+    std::vector<Diagnostic> diagnostics() const;
+
+    /**
+     * @brief buildAst puts together the tree for the whole program. Symbol
+     * IDs are the document's own; they stay the same across edits.
+     */
+    void buildAst(Ast& ast) const;
+
+    size_t segmentCount() const;
+
+    /**
+     * @brief EditStats describes the work done by the last edit.
+     */
+    struct EditStats
+    {
+        size_t relexedBytes = 0;
+        size_t reparsedSegments = 0;
+    };
+
+    const EditStats& lastEdit() const
+    {
+        return m_lastEdit;
+    }
+
+private:
+    static constexpr uint32_t NO_BREAK = UINT32_MAX;
+
+    struct Segment
+    {
+        std::string text;
+
+        // The segment's statements with offsets relative to its start, and
+        // symbols from the document's table.
+        Ast ast;
+
+        // Positions are relative to the start of the segment, as if it began
+        // a file of its own.
+        std::vector<Diagnostic> diagnostics;
+
+        bool foundEnd = false;
+        bool parsedAsLast = false;
+
+        // Line breaks in the text: the number of \n, and the first and last
+        // \r or \n, for placing the segment in the whole text.
+        uint32_t newlines = 0;
+        uint32_t firstBreak = NO_BREAK;
+        uint32_t lastBreak = NO_BREAK;
+    };
+
+    struct Block
+    {
+        std::vector<Segment> segments;
+        size_t length = 0;
+    };
+
+    struct Location
+    {
+        size_t block;
+        size_t index;
+
+        // Offset of the segment's first character in the text.
+        size_t start;
+    };
+
+    /**
+     * @brief locate finds the segment holding the character at
+     * {@code offset}, or the last segment if the offset is the end of the
+     * text.
+     */
+    Location locate(size_t offset) const;
+
+    /**
+     * @brief split cuts text into segments after semicolons, the first
+     * segment of the document getting at least three of them.
+     */
+    static std::vector<std::string_view> split(std::string_view text,
+                                               bool first);
+
+    /**
+     * @brief parse lexes and parses a segment on its own.
+     */
+    void parse(Segment& segment, bool first, bool last);
+
+    /**
+     * @brief place works out the position in the whole text that follows a
+     * segment starting at {@code line}:{@code column}.
+     */
+    static void place(const Segment& segment, size_t& line, size_t& column);
+
+    /**
+     * @brief rebalance drops empty blocks and splits blocks that have grown
+     * too large in the range [first, last] of blocks, then recounts their
+     * lengths.
+     */
+    void rebalance(size_t first, size_t last);
+
+    std::vector<Block> m_blocks;
+    size_t m_length;
+
+    // Every identifier that has appeared in the document.
+    SymbolTable m_symbols;
+
+    Tokenizer m_tokenizer;
+    Parser m_parser;
+
+    EditStats m_lastEdit;
+};
+
+#endif // DOCUMENT_HPP
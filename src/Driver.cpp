@@ -0,0 +1,462 @@
+#include "Driver.hpp"
+
+#include "ChunkReader.hpp"
+#include "Dataflow.hpp"
+#include "Ir.hpp"
+#include "MappedFile.hpp"
+#include "ParallelParser.hpp"
+#include "Parser.hpp"
+#include "ResultCache.hpp"
+#include "ResultCodec.hpp"
+#include "ThreadPool.hpp"
+#include "Tokenizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+/**
+ * @brief needsTree returns whether anything done after parsing uses the tree,
+ * so whether the parser has to keep it.
+ * @param positions whether the source's positions are known; warnings can't
+ * be reported without them, so aren't looked for
+ */
+bool needsTree(const CompileOptions& options, bool positions)
+{
+    return options.optimize || options.dumpAst || options.dumpIr ||
+           options.bytecode || options.dumpBytecode ||
+           (options.warnings && positions);
+}
+
+/**
+ * @brief finish fills in a result from whichever parser was used.
+ * @param lines the positions of the source, or null if it's gone
+ */
+template <typename ParserType>
+void finish(CompileResult& result,
+            bool compiled,
+            ParserType& parser,
+            const CompileOptions& options,
+            const LineIndex* lines,
+            Stats* stats)
+{
+    if (stats != nullptr) {
+        const Ast& ast = parser.ast();
+        size_t statements = 0;
+
+        if (ast.root() != NO_NODE) {
+            for (NodeId id = ast.node(ast.root()).firstChild; id != NO_NODE;
+                 id = ast.node(id).nextSibling) {
+                statements++;
+            }
+        }
+
+        stats->add(Stats::Counter::STATEMENTS, statements);
+        stats->add(Stats::Counter::DIAGNOSTICS,
+                   parser.diagnostics().errorCount());
+    }
+
+    if (compiled) {
+        result.status = CompileResult::Status::COMPILED;
+
+        // Before the optimizer removes anything.
+        if (options.warnings && lines != nullptr) {
+            Stats::Timer timer{stats, Stats::Phase::ANALYZE};
+            result.diagnostics = findUninitializedReads(parser.ast(), *lines);
+        }
+
+        if (options.optimize) {
+            Stats::Timer timer{stats, Stats::Phase::OPTIMIZE};
+            Optimizer optimizer;
+            result.optimizerStats = optimizer.optimize(parser.ast());
+        }
+
+        if (options.dumpAst) {
+            Stats::Timer timer{stats, Stats::Phase::DUMP_AST};
+            std::ostringstream stream;
+            parser.ast().dump(stream);
+            result.ast = stream.str();
+        }
+
+        if (options.dumpIr) {
+            Stats::Timer timer{stats, Stats::Phase::LOWER_IR};
+            std::ostringstream stream;
+            Ir::lower(parser.ast()).dump(stream);
+            result.ir = stream.str();
+        }
+
+        if (options.bytecode || options.dumpBytecode) {
+            Stats::Timer timer{stats, Stats::Phase::BYTECODE};
+            result.bytecode = Bytecode::compile(parser.ast());
+        }
+    } else {
+        result.status = CompileResult::Status::FAILED;
+        result.diagnostics = parser.diagnostics().diagnostics();
+    }
+}
+
+/**
+ * @brief parse compiles a source, held by the caller, with no caching of the
+ * result.
+ */
+void parse(CompileResult& result,
+           const std::string& fileName,
+           std::string_view source,
+           const CompileOptions& options,
+           Stats* stats)
+{
+    // Only built if a diagnostic needs a position.
+    LineIndex lines{source.data(), source.size()};
+
+    if (options.parallel) {
+        ThreadPool pool{options.jobs};
+        ParallelParser parser{pool};
+        bool compiled;
+        {
+            Stats::Timer timer{stats, Stats::Phase::PARSE};
+            compiled = parser.parse(source.data(), source.size());
+        }
+
+        if (stats != nullptr) {
+            stats->addTokens(parser.tokenCounts());
+        }
+
+        finish(result, compiled, parser, options, &lines, stats);
+        return;
+    }
+
+    Tokenizer tokenizer;
+    tokenizer.viewSource(source.data(), 0, source.size(), &lines);
+
+    bool cached = false;
+    if (options.tokenCache) {
+        Stats::Timer timer{stats, Stats::Phase::LOAD};
+        cached = tokenizer.useTokenCache(fileName + ".tokcache");
+    }
+
+    Parser parser{tokenizer};
+    parser.discardTree(!needsTree(options, true));
+
+    bool compiled;
+    {
+        Stats::Timer timer{stats, Stats::Phase::PARSE};
+        compiled = parser.parse();
+    }
+
+    if (stats != nullptr) {
+        stats->add(Stats::Counter::STATEMENTS, parser.discardedStatements());
+        stats->add(Stats::Counter::TOKEN_CACHE_HITS, cached ? 1 : 0);
+        stats->addTokens(tokenizer.tokenCounts());
+    }
+
+    finish(result, compiled, parser, options, &lines, stats);
+}
+
+/**
+ * @brief compile compiles a source, or takes its result from the result cache
+ * if there is one.
+ */
+CompileResult compile(const std::string& fileName,
+                      std::string_view source,
+                      const CompileOptions& options,
+                      CompileResult result)
+{
+    Stats* stats = options.stats ? &result.stats : nullptr;
+
+    // Token offsets are 32 bits wide.
+    if (source.size() > std::numeric_limits<uint32_t>::max()) {
+        result.status = CompileResult::Status::UNREADABLE;
+        return result;
+    }
+
+    if (stats != nullptr) {
+        stats->add(Stats::Counter::BYTES_READ, source.size());
+    }
+
+    if (options.resultCache.empty()) {
+        parse(result, fileName, source, options, stats);
+        return result;
+    }
+
+    ResultCache cache{options.resultCache};
+    uint64_t key;
+    bool hit;
+    {
+        Stats::Timer timer{stats, Stats::Phase::CACHE};
+        key = ResultCache::key(source.data(), source.size(), options);
+        hit = cache.load(key, result);
+
+        // An entry missing the bytecode asked for is damaged, so a miss.
+        // Nothing it held may be left behind for the compile to add to.
+        if (hit && !ResultCodec::hasBytecode(result, options)) {
+            Stats kept = std::move(result.stats);
+            result = CompileResult{};
+            result.stats = std::move(kept);
+            hit = false;
+        }
+    }
+
+    if (hit) {
+        if (stats != nullptr) {
+            stats->add(Stats::Counter::RESULT_CACHE_HITS, 1);
+        }
+        return result;
+    }
+
+    parse(result, fileName, source, options, stats);
+
+    {
+        Stats::Timer timer{stats, Stats::Phase::CACHE};
+        cache.store(key, result);
+    }
+
+    return result;
+}
+} // namespace
+
+CompileResult compileFile(const std::string& fileName,
+                          const CompileOptions& options)
+{
+    CompileResult result;
+    Stats* stats = options.stats ? &result.stats : nullptr;
+
+    MappedFile file;
+    bool loaded;
+    {
+        Stats::Timer timer{stats, Stats::Phase::LOAD};
+        loaded = file.open(fileName);
+    }
+
+    if (!loaded) {
+        result.status = CompileResult::Status::UNREADABLE;
+        return result;
+    }
+
+    return compile(fileName, std::string_view{file.data(), file.size()},
+                   options, std::move(result));
+}
+
+CompileResult compileSource(const std::string& name,
+                            std::string_view source,
+                            const CompileOptions& options)
+{
+    // There's no file to keep a token cache beside.
+    CompileOptions sourceOptions = options;
+    sourceOptions.tokenCache = false;
+
+    return compile(name, source, sourceOptions, CompileResult{});
+}
+
+CompileResult compileStream(int fd,
+                            const CompileOptions& options,
+                            const DiagnosticSink::Handler& report)
+{
+    CompileResult result;
+    Stats* stats = options.stats ? &result.stats : nullptr;
+
+    ChunkReader reader{fd};
+    Tokenizer tokenizer;
+    tokenizer.streamFrom(reader);
+
+    Parser parser{tokenizer};
+    parser.diagnostics().setHandler(report);
+
+    // Unless the tree is wanted afterwards, don't keep it.
+    parser.discardTree(!needsTree(options, false));
+
+    bool compiled;
+    {
+        Stats::Timer timer{stats, Stats::Phase::PARSE};
+        compiled = parser.parse();
+    }
+
+    if (stats != nullptr) {
+        stats->add(Stats::Counter::BYTES_READ, reader.bytesRead());
+        stats->add(Stats::Counter::STATEMENTS, parser.discardedStatements());
+        stats->addTokens(tokenizer.tokenCounts());
+    }
+
+    finish(result, compiled, parser, options, nullptr, stats);
+    return result;
+}
+
+Driver::Driver(CompileOptions options, unsigned jobs)
+    : m_options{options}
+    , m_jobs{jobs}
+{}
+
+bool Driver::addInput(const std::string& input)
+{
+    namespace fs = std::filesystem;
+
+    // A list of inputs, one per line.
+    if (!input.empty() && input[0] == '@') {
+        std::ifstream list{input.substr(1)};
+        if (!list) {
+            return false;
+        }
+
+        bool ok = true;
+        std::string line;
+
+        while (std::getline(list, line)) {
+            // Ignore surrounding whitespace and blank lines.
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos) {
+                continue;
+            }
+            size_t end = line.find_last_not_of(" \t\r");
+
+            ok = addInput(line.substr(begin, end - begin + 1)) && ok;
+        }
+
+        return ok;
+    }
+
+    std::error_code error;
+
+    if (!fs::is_directory(input, error)) {
+        m_files.push_back(input);
+        return true;
+    }
+
+    // Every .pas file below a directory, sorted so the order doesn't depend
+    // on the file system.
+    std::vector<std::string> found;
+
+    for (fs::recursive_directory_iterator it{input, error}, end;
+         !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error) && it->path().extension() == ".pas") {
+            found.push_back(it->path().string());
+        }
+    }
+
+    if (error) {
+        return false;
+    }
+
+    std::sort(found.begin(), found.end());
+    m_files.insert(m_files.end(), found.begin(), found.end());
+
+    return true;
+}
+
+bool Driver::run(std::ostream& stream)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    m_stats = Stats{};
+    m_fileStats.clear();
+
+    size_t count = m_files.size();
+    std::vector<CompileResult> results(count);
+    std::vector<char> done(count, false);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    ThreadPool pool{m_jobs};
+
+    // The files are the unit of work, so each is parsed on a single thread.
+    CompileOptions options = m_options;
+    options.parallel = false;
+
+    for (size_t i = 0; i < count; i++) {
+        pool.submit([&, i] {
+            CompileResult result = compileFile(m_files[i], options);
+
+            std::lock_guard<std::mutex> lock{mutex};
+            results[i] = std::move(result);
+            done[i] = true;
+            finished.notify_one();
+        });
+    }
+
+    size_t compiled = 0;
+    size_t failed = 0;
+    size_t unreadable = 0;
+    size_t errors = 0;
+
+    // Write the results in order as they become available.
+    for (size_t i = 0; i < count; i++) {
+        CompileResult result;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            finished.wait(lock, [&] { return done[i] != 0; });
+            result = std::move(results[i]);
+        }
+
+        const std::string& fileName = m_files[i];
+        Stats* stats = m_options.stats ? &result.stats : nullptr;
+        {
+            Stats::Timer timer{stats, Stats::Phase::FORMAT};
+
+            switch (result.status) {
+            case CompileResult::Status::COMPILED:
+                compiled++;
+                for (const Diagnostic& diagnostic : result.diagnostics) {
+                    stream << fileName << ": " << diagnostic << "\n";
+                }
+                stream << fileName << ": Successfully compiled.\n";
+                if (m_options.optimizerStats) {
+                    stream << result.optimizerStats;
+                }
+                stream << result.ast << result.ir;
+                if (m_options.dumpBytecode) {
+                    result.bytecode.disassemble(stream);
+                }
+                break;
+            case CompileResult::Status::FAILED:
+                failed++;
+                errors += result.diagnostics.size();
+                for (const Diagnostic& diagnostic : result.diagnostics) {
+                    stream << fileName << ": " << diagnostic << "\n";
+                }
+                break;
+            case CompileResult::Status::UNREADABLE:
+                unreadable++;
+                stream << fileName << ": Unable to load file.\n";
+                break;
+            }
+        }
+
+        if (stats != nullptr) {
+            m_stats += result.stats;
+            m_fileStats.push_back(std::move(result.stats));
+        }
+    }
+
+    pool.wait();
+
+    if (!m_options.resultCache.empty()) {
+        ResultCache{m_options.resultCache}.trim(m_options.resultCacheLimit);
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    stream << "Compiled " << count << " files with " << pool.size()
+           << " threads in " << elapsed.count() << "s: " << compiled
+           << " succeeded, " << failed << " failed with " << errors
+           << " errors, " << unreadable << " unreadable." << std::endl;
+
+    return compiled == count;
+}
+
+void Driver::writeTrace(std::ostream& stream) const
+{
+    std::vector<TraceTrack> tracks;
+
+    for (size_t i = 0; i < m_fileStats.size(); i++) {
+        tracks.push_back(TraceTrack{m_files[i], &m_fileStats[i]});
+    }
+
+    ::writeTrace(stream, tracks);
+}
@@ -0,0 +1,182 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include "Bytecode.hpp"
+#include "Diagnostics.hpp"
+#include "Optimizer.hpp"
+#include "Stats.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CompileOptions
+{
+    // Keep the tree of successfully compiled files, printed as source code.
+    bool dumpAst = false;
+
+    // Simplify the expressions of successfully compiled files, and print what
+    // was removed.
+    bool optimize = false;
+    bool optimizerStats = false;
+
+    // Print successfully compiled files in SSA form.
+    bool dumpIr = false;
+
+    // Lower successfully compiled files to bytecode.
+    bool bytecode = false;
+
+    // Print the bytecode of successfully compiled files.
+    bool dumpBytecode = false;
+
+    // Warn of variables that successfully compiled files read before
+    // assigning. The warnings are the diagnostics of the result.
+    bool warnings = false;
+
+    // Parse the file on several threads with a ParallelParser, rather than on
+    // the calling thread. Files in a batch are always parsed one per thread.
+    bool parallel = false;
+
+    // Threads to parse a single file with, or 0 for one per hardware thread.
+    unsigned jobs = 0;
+
+    // Time each phase and count what it processed.
+    bool stats = false;
+
+    // Take the tokens of an unchanged file from the cache beside it, named
+    // after the file with ".tokcache" added, and write the cache when it's
+    // missing or stale. Files parsed by a ParallelParser don't use it.
+    bool tokenCache = false;
+
+    // A directory to keep the result of every file in, so a file compiled
+    // before with the same options isn't compiled again. Empty for none.
+    std::string resultCache;
+
+    // The most the results in the directory may take up, enforced by
+    // trimming the least recently used when a run ends.
+    uint64_t resultCacheLimit = 256 << 20;
+};
+
+/**
+ * @brief CompileResult is the outcome of compiling one file.
+ */
+struct CompileResult
+{
+    enum class Status
+    {
+        COMPILED,
+        FAILED,
+        UNREADABLE,
+    };
+
+    Status status = Status::UNREADABLE;
+
+    // The errors of a file that failed, or the warnings of one that compiled.
+    std::vector<Diagnostic> diagnostics;
+
+    // What the optimizer removed, if it was run.
+    OptimizerStats optimizerStats;
+
+    // The dumped tree, if it was asked for and the file compiled.
+    std::string ast;
+
+    // The dumped SSA form, if it was asked for and the file compiled.
+    std::string ir;
+
+    // The lowered program, if it was asked for and the file compiled.
+    Bytecode bytecode;
+
+    // Where the time went, if it was asked for.
+    Stats stats;
+};
+
+/**
+ * @brief compileFile tokenizes and parses a single file. Everything it uses is
+ * local to the call, so any number of files can be compiled at once.
+ */
+CompileResult compileFile(const std::string& fileName,
+                          const CompileOptions& options);
+
+/**
+ * @brief compileSource compiles source held in memory as though it had been
+ * read from a file of the given name, for sources that were never on disk.
+ */
+CompileResult compileSource(const std::string& name,
+                            std::string_view source,
+                            const CompileOptions& options);
+
+/**
+ * @brief compileStream compiles a stream, such as a pipe, as it arrives. Only
+ * a little of the stream is held at a time, and each diagnostic is reported
+ * as soon as it's found rather than kept in the result.
+ *
+ * Neither cache is used, and the tree is kept only when an option needs it.
+ * There are no warnings, as the source they'd point into is gone by the time
+ * the program has been read.
+ * @param fd the file descriptor to read, 0 for the standard input
+ */
+CompileResult compileStream(int fd,
+                            const CompileOptions& options,
+                            const DiagnosticSink::Handler& report);
+
+/**
+ * @brief Driver compiles a batch of files in parallel on a {@code ThreadPool}.
+ */
+class Driver
+{
+public:
+    /**
+     * @param jobs how many files to compile at once, or 0 for one per hardware
+     * thread
+     */
+    Driver(CompileOptions options, unsigned jobs = 0);
+
+    /**
+     * @brief addInput adds files to the batch. A directory adds every .pas
+     * file below it, in name order, and "@list" adds every input named in the
+     * file list, one per line. Anything else is taken to be a file.
+     * @return false if a directory or list couldn't be read
+     */
+    bool addInput(const std::string& input);
+
+    const std::vector<std::string>& files() const
+    {
+        return m_files;
+    }
+
+    /**
+     * @brief run compiles every file. Each file's result is written as soon as
+     * it and all files before it have finished, so the output is in input
+     * order however the work was scheduled. A summary follows the results.
+     * @return true if every file compiled
+     */
+    bool run(std::ostream& stream);
+
+    /**
+     * @brief stats returns the stats of every file in the last run added
+     * together, if they were asked for.
+     */
+    const Stats& stats() const
+    {
+        return m_stats;
+    }
+
+    /**
+     * @brief writeTrace writes the phases of the last run as a Chrome trace,
+     * with a track for each file.
+     */
+    void writeTrace(std::ostream& stream) const;
+
+private:
+    CompileOptions m_options;
+    unsigned m_jobs;
+
+    std::vector<std::string> m_files;
+
+    Stats m_stats;
+    std::vector<Stats> m_fileStats;
+};
+
+#endif // DRIVER_HPP
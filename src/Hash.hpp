@@ -0,0 +1,14 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief hash64 returns the XXH64 hash of a buffer. It reads eight bytes at a
+ * time, so hashing a source file costs far less than lexing it, which makes it
+ * cheap enough to key caches on a file's contents.
+ */
+uint64_t hash64(const void* data, size_t length, uint64_t seed = 0);
+
+#endif // HASH_HPP
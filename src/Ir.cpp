@@ -0,0 +1,259 @@
+#include "Ir.hpp"
+
+#include <unordered_map>
+
+/**
+ * @brief IrBuilder lowers a tree one node at a time as it's walked.
+ *
+ * Each open expression keeps the value computed so far. Its first operand is
+ * taken as it is, and every following operand adds to or subtracts from it,
+ * giving a new temporary. Variables are looked up in the versions current at
+ * that point, so the value of a variable is wherever it was last defined.
+ */
+class IrBuilder : public AstVisitor
+{
+public:
+    IrBuilder(Ir& ir)
+        : m_ir{ir}
+        , m_finished{NO_VALUE}
+    {}
+
+    void start(const Ast& ast)
+    {
+        for (size_t i = 0; i < ast.symbolCount(); i++) {
+            m_ir.m_names.emplace_back(ast.symbolName(i));
+        }
+
+        m_current.assign(ast.symbolCount(), NO_VALUE);
+        m_versions.assign(ast.symbolCount(), 0);
+    }
+
+    bool enter(const Ast& ast, NodeId id) override
+    {
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::WRITE:
+            m_writeArguments.clear();
+            break;
+        case AstNode::Kind::EXPR:
+            m_exprs.push_back(NO_VALUE);
+            break;
+        case AstNode::Kind::IDENTIFIER:
+            if (ast.node(m_parents.back()).kind == AstNode::Kind::READ) {
+                define(emit(IrOp::READ), node.value);
+            } else {
+                operand(node.op, variable(node.value));
+            }
+            break;
+        case AstNode::Kind::INTEGER:
+            operand(node.op, constant(ast.integer(id)));
+            break;
+        default:
+            break;
+        }
+
+        m_parents.push_back(id);
+        return true;
+    }
+
+    void leave(const Ast& ast, NodeId id) override
+    {
+        m_parents.pop_back();
+        const AstNode& node = ast.node(id);
+
+        switch (node.kind) {
+        case AstNode::Kind::WRITE: {
+            auto first = static_cast<ValueId>(m_ir.m_arguments.size());
+            m_ir.m_arguments.insert(m_ir.m_arguments.end(),
+                                    m_writeArguments.begin(),
+                                    m_writeArguments.end());
+            emit(IrOp::WRITE, first,
+                 static_cast<ValueId>(m_writeArguments.size()));
+            break;
+        }
+        case AstNode::Kind::ASSIGN:
+            // A temporary the expression computed becomes the new version
+            // itself. Anything else, a variable or constant on its own, needs
+            // a copy to be given the variable's name.
+            if (m_ir.m_variables[m_finished] == NO_VALUE &&
+                (m_ir.m_ops[m_finished] == IrOp::ADD ||
+                 m_ir.m_ops[m_finished] == IrOp::SUB)) {
+                define(m_finished, node.value);
+            } else {
+                define(emit(IrOp::COPY, m_finished), node.value);
+            }
+            break;
+        case AstNode::Kind::EXPR:
+            m_finished = m_exprs.back();
+            m_exprs.pop_back();
+
+            if (ast.node(m_parents.back()).kind == AstNode::Kind::WRITE) {
+                m_writeArguments.push_back(m_finished);
+            }
+            break;
+        case AstNode::Kind::GROUP:
+            operand(node.op, m_finished);
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    /**
+     * @brief operand adds or subtracts a value from the innermost expression.
+     */
+    void operand(AstNode::Op op, ValueId value)
+    {
+        ValueId& total = m_exprs.back();
+        IrOp arithmetic = op == AstNode::Op::PLUS ? IrOp::ADD : IrOp::SUB;
+
+        if (total != NO_VALUE) {
+            total = emit(arithmetic, total, value);
+        } else if (op == AstNode::Op::PLUS) {
+            total = value;
+        } else {
+            total = emit(IrOp::SUB, constant(0), value);
+        }
+    }
+
+    /**
+     * @brief variable returns the current version of a variable, defining its
+     * INITIAL version the first time it's used before being assigned.
+     */
+    ValueId variable(uint32_t symbol)
+    {
+        if (m_current[symbol] == NO_VALUE) {
+            define(emit(IrOp::INITIAL), symbol);
+        }
+
+        return m_current[symbol];
+    }
+
+    /**
+     * @brief define makes a value the next version of a variable.
+     */
+    void define(ValueId value, uint32_t symbol)
+    {
+        m_ir.m_variables[value] = symbol;
+
+        // INITIAL is version 0, which is only used if it's defined first.
+        if (m_ir.m_ops[value] != IrOp::INITIAL) {
+            m_versions[symbol]++;
+        }
+        m_ir.m_versions[value] = m_versions[symbol];
+
+        m_current[symbol] = value;
+    }
+
+    ValueId constant(int64_t value)
+    {
+        // Constants are only defined once. The program is a straight line, so
+        // the first definition comes before every use.
+        auto found = m_constants.find(value);
+        if (found != m_constants.end()) {
+            return found->second;
+        }
+
+        auto index = static_cast<ValueId>(m_ir.m_constants.size());
+        m_ir.m_constants.push_back(value);
+
+        ValueId id = emit(IrOp::CONST, index);
+        m_constants.emplace(value, id);
+
+        return id;
+    }
+
+    ValueId emit(IrOp op, ValueId left = NO_VALUE, ValueId right = NO_VALUE)
+    {
+        auto id = static_cast<ValueId>(m_ir.m_ops.size());
+
+        m_ir.m_ops.push_back(op);
+        m_ir.m_left.push_back(left);
+        m_ir.m_right.push_back(right);
+        m_ir.m_variables.push_back(NO_VALUE);
+        m_ir.m_versions.push_back(0);
+
+        return id;
+    }
+
+    Ir& m_ir;
+
+    // The current version of each variable, and how many it has had.
+    std::vector<ValueId> m_current;
+    std::vector<uint32_t> m_versions;
+
+    // The nodes being visited, and the values of the expressions among them.
+    std::vector<NodeId> m_parents;
+    std::vector<ValueId> m_exprs;
+
+    // The value of the expression that was just left.
+    ValueId m_finished;
+
+    std::vector<ValueId> m_writeArguments;
+
+    std::unordered_map<int64_t, ValueId> m_constants;
+};
+
+Ir Ir::lower(const Ast& ast)
+{
+    Ir ir;
+    IrBuilder builder{ir};
+
+    builder.start(ast);
+    ast.walk(builder);
+
+    return ir;
+}
+
+void Ir::dump(std::ostream& stream) const
+{
+    auto name = [this](ValueId id) {
+        if (m_variables[id] == NO_VALUE) {
+            return "%" + std::to_string(id);
+        }
+
+        return m_names[m_variables[id]] + "." + std::to_string(m_versions[id]);
+    };
+
+    for (ValueId id = 0; id < size(); id++) {
+        if (m_ops[id] == IrOp::WRITE) {
+            stream << "write";
+
+            for (ValueId i = 0; i < m_right[id]; i++) {
+                stream << (i == 0 ? " " : ", ") << name(arguments(id)[i]);
+            }
+
+            stream << "\n";
+            continue;
+        }
+
+        stream << name(id) << " = ";
+
+        switch (m_ops[id]) {
+        case IrOp::CONST:
+            stream << "const " << constant(id);
+            break;
+        case IrOp::INITIAL:
+            stream << "initial";
+            break;
+        case IrOp::READ:
+            stream << "read";
+            break;
+        case IrOp::ADD:
+            stream << "add " << name(m_left[id]) << ", " << name(m_right[id]);
+            break;
+        case IrOp::SUB:
+            stream << "sub " << name(m_left[id]) << ", " << name(m_right[id]);
+            break;
+        case IrOp::COPY:
+            stream << "copy " << name(m_left[id]);
+            break;
+        case IrOp::WRITE:
+            break;
+        }
+
+        stream << "\n";
+    }
+}
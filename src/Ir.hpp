@@ -0,0 +1,140 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include "Ast.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using ValueId = uint32_t;
+
+// Marks a missing operand, or a value that isn't a variable.
+constexpr ValueId NO_VALUE = UINT32_MAX;
+
+/**
+ * @brief IrOp is the operation of an {@code Ir} instruction. Every instruction
+ * but WRITE defines a value, identified by the instruction's index.
+ */
+enum class IrOp : uint8_t
+{
+    // A constant; left indexes the constants.
+    CONST,
+    // A variable before anything is assigned to it, which is zero.
+    INITIAL,
+    // An integer read from the input.
+    READ,
+    // left + right, wrapping around on overflow.
+    ADD,
+    // left - right, wrapping around on overflow.
+    SUB,
+    // left under a new name, for assigning a lone operand.
+    COPY,
+    // Writes the arguments [left, left + right) on one line.
+    WRITE,
+};
+
+/**
+ * @brief Ir is a program in three-address SSA form: a straight line of
+ * instructions, each defining at most one value, whose operands are values
+ * defined earlier. Every assignment and READ defines a new version of its
+ * variable, and the operators of an expression become a chain of temporaries.
+ *
+ * Instructions are stored as parallel arrays indexed by {@code ValueId}.
+ */
+class Ir
+{
+public:
+    /**
+     * @brief lower translates a parsed program. The tree has to be free of
+     * syntax errors.
+     */
+    static Ir lower(const Ast& ast);
+
+    size_t size() const
+    {
+        return m_ops.size();
+    }
+
+    IrOp op(ValueId id) const
+    {
+        return m_ops[id];
+    }
+
+    ValueId left(ValueId id) const
+    {
+        return m_left[id];
+    }
+
+    ValueId right(ValueId id) const
+    {
+        return m_right[id];
+    }
+
+    /**
+     * @brief constant returns the value of a CONST.
+     */
+    int64_t constant(ValueId id) const
+    {
+        return m_constants[m_left[id]];
+    }
+
+    /**
+     * @brief arguments returns the first of a WRITE's {@code right(id)}
+     * arguments.
+     */
+    const ValueId* arguments(ValueId id) const
+    {
+        return m_arguments.data() + m_left[id];
+    }
+
+    /**
+     * @brief variable returns the symbol ID of the variable a value is a
+     * version of, or NO_VALUE for temporaries.
+     */
+    uint32_t variable(ValueId id) const
+    {
+        return m_variables[id];
+    }
+
+    /**
+     * @brief version numbers the versions of a variable in order, from 0 for
+     * its INITIAL value.
+     */
+    uint32_t version(ValueId id) const
+    {
+        return m_versions[id];
+    }
+
+    const std::string& variableName(uint32_t symbol) const
+    {
+        return m_names[symbol];
+    }
+
+    size_t variableCount() const
+    {
+        return m_names.size();
+    }
+
+    /**
+     * @brief dump writes one instruction per line. Versions of variables are
+     * named NAME.version and temporaries %id.
+     */
+    void dump(std::ostream& stream) const;
+
+private:
+    friend class IrBuilder;
+
+    std::vector<IrOp> m_ops;
+    std::vector<ValueId> m_left;
+    std::vector<ValueId> m_right;
+    std::vector<uint32_t> m_variables;
+    std::vector<uint32_t> m_versions;
+
+    std::vector<int64_t> m_constants;
+    std::vector<ValueId> m_arguments;
+    std::vector<std::string> m_names;
+};
+
+#endif // IR_HPP
@@ -0,0 +1,428 @@
+#include "Jit.hpp"
+
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HAVE_JIT 1
+#else
+#define HAVE_JIT 0
+#endif
+
+#if HAVE_JIT
+namespace
+{
+// The generated code is a function taking the register file and the Jit. It
+// returns false if a READ failed.
+using EntryPoint = bool (*)(int64_t* registers, Jit* jit);
+
+// Displacements from the register file are signed 32 bits.
+const uint32_t MAX_REGISTERS = 1u << 28;
+
+// Marks that rax isn't known to hold any register.
+const uint32_t NO_REGISTER = UINT32_MAX;
+
+/**
+ * @brief Assembler encodes the handful of x86-64 instructions the JIT needs.
+ * Throughout, rbx points at the register file, r12 holds the Jit, and rax
+ * and rcx are scratch.
+ */
+class Assembler
+{
+public:
+    const std::vector<uint8_t>& code() const
+    {
+        return m_code;
+    }
+
+    size_t position() const
+    {
+        return m_code.size();
+    }
+
+    // push rbx; push r12; sub rsp, 8 (keeps calls 16 byte aligned)
+    // mov rbx, rdi; mov r12, rsi
+    void prologue()
+    {
+        bytes({0x53, 0x41, 0x54, 0x48, 0x83, 0xEC, 0x08});
+        bytes({0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4});
+    }
+
+    // add rsp, 8; pop r12; pop rbx; ret
+    void epilogue()
+    {
+        bytes({0x48, 0x83, 0xC4, 0x08, 0x41, 0x5C, 0x5B, 0xC3});
+    }
+
+    // mov rax, R(reg)
+    void load(uint32_t reg)
+    {
+        bytes({0x48, 0x8B});
+        registerOperand(0, reg);
+    }
+
+    // mov R(reg), rax
+    void store(uint32_t reg)
+    {
+        bytes({0x48, 0x89});
+        registerOperand(0, reg);
+    }
+
+    // add rax, R(reg) or sub rax, R(reg)
+    void arithmetic(bool add, uint32_t reg)
+    {
+        bytes({0x48, static_cast<uint8_t>(add ? 0x03 : 0x2B)});
+        registerOperand(0, reg);
+    }
+
+    // mov R(reg), imm32 (sign extended)
+    void storeImmediate(uint32_t reg, int32_t value)
+    {
+        bytes({0x48, 0xC7});
+        registerOperand(0, reg);
+        dword(static_cast<uint32_t>(value));
+    }
+
+    // mov rax, imm64 or mov rcx, imm64
+    void loadImmediate(bool rcx, int64_t value)
+    {
+        bytes({0x48, static_cast<uint8_t>(rcx ? 0xB9 : 0xB8)});
+        qword(static_cast<uint64_t>(value));
+    }
+
+    // add rax, imm32 or sub rax, imm32 (sign extended)
+    void arithmeticImmediate(bool add, int32_t value)
+    {
+        bytes({0x48, static_cast<uint8_t>(add ? 0x05 : 0x2D)});
+        dword(static_cast<uint32_t>(value));
+    }
+
+    // add rax, rcx or sub rax, rcx
+    void arithmeticRcx(bool add)
+    {
+        bytes({0x48, static_cast<uint8_t>(add ? 0x01 : 0x29), 0xC8});
+    }
+
+    // mov eax, imm32
+    void setEax(uint32_t value)
+    {
+        byte(0xB8);
+        dword(value);
+    }
+
+    // xor eax, eax
+    void clearEax()
+    {
+        bytes({0x31, 0xC0});
+    }
+
+    /**
+     * @brief call calls a runtime function with the Jit and up to two more
+     * 32-bit arguments: mov rdi, r12; mov esi, first; mov edx, second;
+     * mov rax, function; call rax.
+     */
+    void call(const void* function, uint32_t first, uint32_t second)
+    {
+        bytes({0x4C, 0x89, 0xE7});
+        byte(0xBE);
+        dword(first);
+        byte(0xBA);
+        dword(second);
+        loadImmediate(false, static_cast<int64_t>(
+                                 reinterpret_cast<uintptr_t>(function)));
+        bytes({0xFF, 0xD0});
+    }
+
+    /**
+     * @brief jumpIfFalse tests the bool a call returned and jumps if it's
+     * false: test al, al; jz rel32. The target is filled in by {@code patch}.
+     * @return where the displacement is, for {@code patch}
+     */
+    size_t jumpIfFalse()
+    {
+        bytes({0x84, 0xC0, 0x0F, 0x84});
+        dword(0);
+        return position() - 4;
+    }
+
+    /**
+     * @brief jump jumps unconditionally: jmp rel32.
+     * @return where the displacement is, for {@code patch}
+     */
+    size_t jump()
+    {
+        byte(0xE9);
+        dword(0);
+        return position() - 4;
+    }
+
+    /**
+     * @brief patch points the jump whose displacement is at {@code at} to
+     * {@code target}.
+     */
+    void patch(size_t at, size_t target)
+    {
+        auto displacement = static_cast<uint32_t>(
+            static_cast<int32_t>(target - (at + 4)));
+        std::memcpy(m_code.data() + at, &displacement, 4);
+    }
+
+private:
+    /**
+     * @brief registerOperand encodes [rbx + 8 * reg] as the memory operand,
+     * with {@code field} in the ModRM reg field.
+     */
+    void registerOperand(uint8_t field, uint32_t reg)
+    {
+        uint32_t displacement = reg * 8;
+
+        if (displacement < 128) {
+            byte(static_cast<uint8_t>(0x43 | field << 3));
+            byte(static_cast<uint8_t>(displacement));
+        } else {
+            byte(static_cast<uint8_t>(0x83 | field << 3));
+            dword(displacement);
+        }
+    }
+
+    void byte(uint8_t value)
+    {
+        m_code.push_back(value);
+    }
+
+    void bytes(std::initializer_list<uint8_t> values)
+    {
+        m_code.insert(m_code.end(), values);
+    }
+
+    void dword(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++) {
+            byte(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void qword(uint64_t value)
+    {
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    std::vector<uint8_t> m_code;
+};
+
+bool fitsInt32(int64_t value)
+{
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+} // namespace
+#endif
+
+Jit::Jit(std::istream& input, std::ostream& output)
+    : m_io{input, output}
+{}
+
+Jit::~Jit()
+{
+    release();
+}
+
+bool Jit::supported()
+{
+    return HAVE_JIT;
+}
+
+bool Jit::compile(const Bytecode& bytecode)
+{
+    release();
+    m_error.clear();
+    m_bytecode = &bytecode;
+
+#if HAVE_JIT
+    if (bytecode.registers() > MAX_REGISTERS) {
+        m_error = "Too many registers to compile.";
+        return false;
+    }
+
+    const std::vector<int64_t>& constants = bytecode.constants();
+
+    Assembler assembler;
+    assembler.prologue();
+
+    // Jumps to the end of the program, either failing or finished.
+    std::vector<size_t> failures;
+    std::vector<size_t> finishes;
+
+    // The register rax was last stored to, so loading it again can be
+    // skipped. There are no branches, so this only has to follow the
+    // instructions in order.
+    uint32_t cached = NO_REGISTER;
+
+    auto load = [&](uint32_t reg) {
+        if (reg != cached) {
+            assembler.load(reg);
+        }
+    };
+
+    auto store = [&](uint32_t reg) {
+        assembler.store(reg);
+        cached = reg;
+    };
+
+    for (const Instruction& instruction : bytecode.code()) {
+        switch (instruction.opcode) {
+        case Opcode::LOADK: {
+            int64_t value = constants[instruction.b];
+
+            if (fitsInt32(value)) {
+                assembler.storeImmediate(instruction.a,
+                                         static_cast<int32_t>(value));
+                if (cached == instruction.a) {
+                    cached = NO_REGISTER;
+                }
+            } else {
+                assembler.loadImmediate(false, value);
+                store(instruction.a);
+            }
+            break;
+        }
+        case Opcode::MOVE:
+            load(instruction.b);
+            store(instruction.a);
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+            load(instruction.b);
+            assembler.arithmetic(instruction.opcode == Opcode::ADD,
+                                 instruction.c);
+            store(instruction.a);
+            break;
+        case Opcode::ADDK:
+        case Opcode::SUBK: {
+            bool add = instruction.opcode == Opcode::ADDK;
+            int64_t value = constants[instruction.c];
+
+            load(instruction.b);
+            if (fitsInt32(value)) {
+                assembler.arithmeticImmediate(add, static_cast<int32_t>(value));
+            } else {
+                assembler.loadImmediate(true, value);
+                assembler.arithmeticRcx(add);
+            }
+            store(instruction.a);
+            break;
+        }
+        case Opcode::READ:
+            assembler.call(reinterpret_cast<const void*>(&Jit::read),
+                           instruction.a, 0);
+            failures.push_back(assembler.jumpIfFalse());
+            cached = NO_REGISTER;
+            break;
+        case Opcode::WRITE:
+            assembler.call(reinterpret_cast<const void*>(&Jit::write),
+                           instruction.a, instruction.b);
+            cached = NO_REGISTER;
+            break;
+        case Opcode::HALT:
+            assembler.setEax(1);
+            finishes.push_back(assembler.jump());
+            break;
+        }
+    }
+
+    size_t failure = assembler.position();
+    assembler.clearEax();
+
+    size_t finish = assembler.position();
+    assembler.epilogue();
+
+    for (size_t at : failures) {
+        assembler.patch(at, failure);
+    }
+    for (size_t at : finishes) {
+        assembler.patch(at, finish);
+    }
+
+    // Write the code while the memory is writable, then make it executable
+    // instead, so it's never both.
+    const std::vector<uint8_t>& code = assembler.code();
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (code.size() + page - 1) / page * page;
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        m_error = "Unable to allocate memory for machine code.";
+        return false;
+    }
+
+    std::memcpy(memory, code.data(), code.size());
+
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        m_error = "Unable to make machine code executable.";
+        return false;
+    }
+
+    m_code = memory;
+    m_codeSize = code.size();
+    m_mappedSize = size;
+    return true;
+#else
+    m_error = "Machine code generation isn't supported on this platform.";
+    return false;
+#endif
+}
+
+bool Jit::run()
+{
+#if HAVE_JIT
+    if (m_code == nullptr) {
+        m_error = "No program has been compiled.";
+        return false;
+    }
+
+    m_error.clear();
+    m_registers.assign(m_bytecode->registers(), 0);
+
+    bool ok = reinterpret_cast<EntryPoint>(m_code)(m_registers.data(), this);
+
+    m_io.flush();
+    return ok;
+#else
+    m_error = "Machine code generation isn't supported on this platform.";
+    return false;
+#endif
+}
+
+bool Jit::read(Jit* jit, uint32_t target) noexcept
+{
+    if (!jit->m_io.read(jit->m_registers[target])) {
+        jit->m_error =
+            "Unable to read a value for " + jit->m_bytecode->name(target) + ".";
+        return false;
+    }
+
+    return true;
+}
+
+void Jit::write(Jit* jit, uint32_t first, uint32_t count) noexcept
+{
+    jit->m_io.write(jit->m_registers.data() + first, count);
+}
+
+void Jit::release()
+{
+#if HAVE_JIT
+    if (m_code != nullptr) {
+        munmap(m_code, m_mappedSize);
+    }
+#endif
+
+    m_code = nullptr;
+    m_codeSize = 0;
+    m_mappedSize = 0;
+}
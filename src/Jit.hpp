@@ -0,0 +1,99 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "Bytecode.hpp"
+#include "Vm.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Jit translates {@code Bytecode} into x86-64 machine code and runs it
+ * natively, for programs that are run many times. The code is written
+ * straight into executable memory; READ and WRITE call back into a
+ * {@code RuntimeIo}, so a program behaves exactly as it does on the
+ * {@code Vm}.
+ *
+ * Only x86-64 Linux is supported. Elsewhere {@code compile} always fails and
+ * callers should fall back to the {@code Vm}.
+ */
+class Jit
+{
+public:
+    Jit(std::istream& input, std::ostream& output);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    /**
+     * @brief supported returns whether machine code can be generated on this
+     * platform.
+     */
+    static bool supported();
+
+    /**
+     * @brief compile translates a program, replacing any compiled before. The
+     * bytecode has to outlive the compiled code, which uses it to name
+     * variables in errors.
+     * @return false if the program can't be compiled here, see {@code error}
+     */
+    bool compile(const Bytecode& bytecode);
+
+    /**
+     * @brief run executes the compiled program from the start. Every variable
+     * starts at zero.
+     * @return false if the program stopped early, see {@code error}
+     */
+    bool run();
+
+    /**
+     * @brief error describes why the last compile or run failed.
+     */
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+    /**
+     * @brief registers returns the registers as the last run left them.
+     */
+    const std::vector<int64_t>& registers() const
+    {
+        return m_registers;
+    }
+
+    /**
+     * @brief codeSize returns the size in bytes of the compiled machine code.
+     */
+    size_t codeSize() const
+    {
+        return m_codeSize;
+    }
+
+private:
+    // Called from the generated code, which passes the Jit along. Nothing may
+    // throw through the generated code, as it has no unwind information.
+    static bool read(Jit* jit, uint32_t target) noexcept;
+    static void write(Jit* jit, uint32_t first, uint32_t count) noexcept;
+
+    /**
+     * @brief release unmaps the compiled code, if any.
+     */
+    void release();
+
+    RuntimeIo m_io;
+    const Bytecode* m_bytecode = nullptr;
+
+    void* m_code = nullptr;
+    size_t m_codeSize = 0;
+    size_t m_mappedSize = 0;
+
+    std::vector<int64_t> m_registers;
+    std::string m_error;
+};
+
+#endif // JIT_HPP
@@ -0,0 +1,129 @@
+#ifndef KEYWORDS_HPP
+#define KEYWORDS_HPP
+
+#include "CharClass.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class Keyword : uint8_t
+{
+    NONE,
+    BEGIN,
+    END,
+    READ,
+    WRITE,
+
+    // Not a keyword but the number of values above, so stored keywords can
+    // be checked however many there are. New keywords go before it.
+    COUNT,
+};
+
+struct KeywordSpelling
+{
+    std::string_view spelling;
+    Keyword keyword;
+};
+
+// The reserved words of the language, spelled in upper case. Keywords are
+// case insensitive.
+constexpr KeywordSpelling KEYWORD_SPELLINGS[] = {
+    {"BEGIN", Keyword::BEGIN},
+    {"END", Keyword::END},
+    {"READ", Keyword::READ},
+    {"WRITE", Keyword::WRITE},
+};
+
+namespace detail
+{
+// Must be a power of two, and large enough that the hash below is perfect.
+constexpr size_t KEYWORD_TABLE_SIZE = 64;
+
+constexpr size_t keywordHash(size_t length, char first, char last)
+{
+    return (static_cast<unsigned char>(foldCase(first)) * 31 +
+            static_cast<unsigned char>(foldCase(last)) * 7 + length) &
+           (KEYWORD_TABLE_SIZE - 1);
+}
+
+struct KeywordTable
+{
+    KeywordSpelling slots[KEYWORD_TABLE_SIZE];
+    size_t minLength;
+    size_t maxLength;
+    bool perfect;
+};
+
+constexpr KeywordTable makeKeywordTable()
+{
+    KeywordTable table{};
+    table.minLength = ~size_t{0};
+    table.maxLength = 0;
+    table.perfect = true;
+
+    for (const auto& entry : KEYWORD_SPELLINGS) {
+        const auto& spelling = entry.spelling;
+        size_t slot = keywordHash(spelling.length(), spelling.front(),
+                                  spelling.back());
+
+        if (table.slots[slot].keyword != Keyword::NONE) {
+            table.perfect = false;
+        }
+
+        table.slots[slot] = entry;
+
+        if (spelling.length() < table.minLength) {
+            table.minLength = spelling.length();
+        }
+        if (spelling.length() > table.maxLength) {
+            table.maxLength = spelling.length();
+        }
+    }
+
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = makeKeywordTable();
+
+static_assert(KEYWORD_TABLE.perfect,
+              "keywords collide in KEYWORD_TABLE, adjust keywordHash or "
+              "grow KEYWORD_TABLE_SIZE");
+} // namespace detail
+
+/**
+ * @brief classifyKeyword looks up an identifier in the keyword table, ignoring
+ * case. The lookup hashes the length and the first and last characters, then
+ * compares against the single candidate in place.
+ * @param text the identifier to classify
+ * @param length the length of the identifier
+ * @return the keyword, or {@code Keyword::NONE} if it's an ordinary identifier
+ */
+constexpr Keyword classifyKeyword(const char* text, size_t length)
+{
+    using namespace detail;
+
+    if (length < KEYWORD_TABLE.minLength || length > KEYWORD_TABLE.maxLength) {
+        return Keyword::NONE;
+    }
+
+    const KeywordSpelling& candidate =
+        KEYWORD_TABLE.slots[keywordHash(length, text[0], text[length - 1])];
+
+    if (candidate.spelling.length() != length) {
+        return Keyword::NONE;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (foldCase(text[i]) != candidate.spelling[i]) {
+            return Keyword::NONE;
+        }
+    }
+
+    return candidate.keyword;
+}
+
+static_assert(classifyKeyword("wRiTe", 5) == Keyword::WRITE, "");
+static_assert(classifyKeyword("ends", 4) == Keyword::NONE, "");
+
+#endif // KEYWORDS_HPP
@@ -0,0 +1,108 @@
+#include "LineIndex.hpp"
+
+#include "Scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+/**
+ * @brief lastBreak returns the last \r or \n in [begin, end), or null if
+ * there isn't one.
+ */
+const char* lastBreak(const char* begin, const char* end)
+{
+    for (const char* c = end; c != begin; c--) {
+        if (c[-1] == '\n' || c[-1] == '\r') {
+            return c - 1;
+        }
+    }
+
+    return nullptr;
+}
+} // namespace
+
+LineIndex::LineIndex()
+    : LineIndex{"", 0}
+{}
+
+LineIndex::LineIndex(const char* data, size_t length)
+    : m_data{data}
+    , m_length{length}
+    , m_built{false}
+{}
+
+void LineIndex::reset(const char* data, size_t length)
+{
+    m_data = data;
+    m_length = length;
+    m_built = false;
+    m_lineStarts.clear();
+    m_returnStarts.clear();
+}
+
+SourcePosition LineIndex::position(size_t offset) const
+{
+    if (!m_built.load(std::memory_order_acquire)) {
+        build();
+    }
+
+    // The line is the last one starting at or before the offset.
+    auto line =
+        std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset) - 1;
+    size_t columnStart = *line;
+
+    // A \r within the line restarts the column too.
+    auto restart = std::upper_bound(m_returnStarts.begin(),
+                                    m_returnStarts.end(), offset);
+    if (restart != m_returnStarts.begin() && restart[-1] > columnStart) {
+        columnStart = restart[-1];
+    }
+
+    return SourcePosition{
+        static_cast<uint32_t>(line - m_lineStarts.begin() + 1),
+        static_cast<uint32_t>(offset - columnStart + 1)};
+}
+
+SourcePosition LineIndex::advance(SourcePosition from,
+                                  const char* begin,
+                                  const char* end)
+{
+    from.lineNumber += static_cast<uint32_t>(scan::countNewlines(begin, end));
+
+    const char* restart = lastBreak(begin, end);
+
+    if (restart == nullptr) {
+        from.columnNumber += static_cast<uint32_t>(end - begin);
+    } else {
+        from.columnNumber = static_cast<uint32_t>(end - restart);
+    }
+
+    return from;
+}
+
+void LineIndex::build() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    // Another thread may have built it while this one waited.
+    if (m_built.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    m_lineStarts.assign(1, 0);
+    scan::findLineStarts(m_data, m_length, m_lineStarts);
+
+    // A \r is rare, so a plain search finds them quickly.
+    m_returnStarts.clear();
+    const char* end = m_data + m_length;
+    for (const char* c = m_data;
+         (c = static_cast<const char*>(std::memchr(c, '\r', end - c))) !=
+         nullptr;) {
+        c++;
+        m_returnStarts.push_back(static_cast<uint32_t>(c - m_data));
+    }
+
+    m_built.store(true, std::memory_order_release);
+}
@@ -0,0 +1,79 @@
+#ifndef LINEINDEX_HPP
+#define LINEINDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief SourcePosition is a line and column, both counted from 1. Lines are
+ * counted by \n, and the column restarts after either \r or \n.
+ */
+struct SourcePosition
+{
+    uint32_t lineNumber;
+    uint32_t columnNumber;
+};
+
+/**
+ * @brief LineIndex turns source offsets into lines and columns. Tokens only
+ * carry offsets, so nothing is spent on positions while lexing; they're
+ * worked out here when a diagnostic needs one.
+ *
+ * The index is the offset of the start of every line, found by one
+ * vectorized pass over the source the first time a position is asked for,
+ * along with the offset just past every \r. Each position is then a binary
+ * search of each, whatever the column. Until then the index costs nothing.
+ */
+class LineIndex
+{
+public:
+    LineIndex();
+
+    /**
+     * @brief The source has to outlive the index's use of it.
+     */
+    LineIndex(const char* data, size_t length);
+
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    /**
+     * @brief reset points the index at another source. It mustn't be called
+     * while a position is being looked up.
+     */
+    void reset(const char* data, size_t length);
+
+    /**
+     * @brief position returns the line and column of an offset, building the
+     * index first if this is the first call. Positions can be looked up from
+     * several threads at once.
+     * @param offset an offset into the source, or its length for the position
+     * just past the end
+     */
+    SourcePosition position(size_t offset) const;
+
+    /**
+     * @brief advance returns the position reached by reading [begin, end)
+     * from {@code from}, for positions in text that isn't all kept.
+     */
+    static SourcePosition advance(SourcePosition from,
+                                  const char* begin,
+                                  const char* end);
+
+private:
+    void build() const;
+
+    const char* m_data;
+    size_t m_length;
+
+    // Built on first use; m_built is set once m_lineStarts is complete.
+    mutable std::mutex m_mutex;
+    mutable std::atomic<bool> m_built;
+    mutable std::vector<uint32_t> m_lineStarts;
+    mutable std::vector<uint32_t> m_returnStarts;
+};
+
+#endif // LINEINDEX_HPP
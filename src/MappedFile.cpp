@@ -0,0 +1,88 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
+MappedFile::MappedFile()
+    : m_data{""}
+    , m_size{0}
+    , m_mapped{false}
+{}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+#ifdef HAVE_MMAP
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // Mapping an empty file fails, so leave the empty view in place.
+    if (info.st_size > 0) {
+        void* address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                               fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+
+        // The tokenizer walks the file front to back exactly once.
+        ::madvise(address, info.st_size, MADV_SEQUENTIAL);
+
+        m_data = static_cast<const char*>(address);
+        m_size = info.st_size;
+        m_mapped = true;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    return true;
+#else
+    std::ifstream fileStream{fileName, std::ios::binary};
+
+    if (!fileStream.is_open()) {
+        return false;
+    }
+
+    m_buffer.assign(std::istreambuf_iterator<char>(fileStream),
+                    std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef HAVE_MMAP
+    if (m_mapped) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+
+    m_buffer.clear();
+    m_data = "";
+    m_size = 0;
+    m_mapped = false;
+}
@@ -0,0 +1,54 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief MappedFile maps a file read-only into memory for the lifetime of the
+ * object. On platforms without mmap the contents are read into a buffer
+ * instead, so callers can always treat data() as a contiguous view.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief open maps the specified file, releasing any previous mapping.
+     * @param fileName the file name to map
+     * @return true if the file exists and was successfully mapped
+     */
+    bool open(const std::string& fileName);
+
+    /**
+     * @brief close releases the current mapping, if any.
+     */
+    void close();
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+
+    // Set when m_data points at an mmap'd region that needs unmapping.
+    bool m_mapped;
+
+    // Used instead of a mapping when mmap isn't available.
+    std::string m_buffer;
+};
+
+#endif // MAPPEDFILE_HPP
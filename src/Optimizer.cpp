@@ -0,0 +1,220 @@
+#include "Optimizer.hpp"
+
+#include "Dataflow.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+AstNode::Op flip(AstNode::Op op)
+{
+    return op == AstNode::Op::PLUS ? AstNode::Op::MINUS : AstNode::Op::PLUS;
+}
+
+AstNode::Op combine(AstNode::Op outer, AstNode::Op inner)
+{
+    return outer == AstNode::Op::PLUS ? inner : flip(inner);
+}
+} // namespace
+
+OptimizerStats& OptimizerStats::operator+=(const OptimizerStats& other)
+{
+    flattened += other.flattened;
+    folded += other.folded;
+    zeros += other.zeros;
+    cancelled += other.cancelled;
+    deadStores += other.deadStores;
+
+    return *this;
+}
+
+std::ostream& operator<<(std::ostream& stream, const OptimizerStats& stats)
+{
+    stream << "Optimizer removed " << stats.total() << " nodes:\n";
+    stream << "  flatten parentheses " << std::setw(10) << stats.flattened
+           << "\n";
+    stream << "  fold constants      " << std::setw(10) << stats.folded << "\n";
+    stream << "  drop + 0            " << std::setw(10) << stats.zeros << "\n";
+    stream << "  cancel x - x        " << std::setw(10) << stats.cancelled
+           << "\n";
+    stream << "  dead stores         " << std::setw(10) << stats.deadStores
+           << "\n";
+
+    return stream;
+}
+
+OptimizerStats Optimizer::optimize(Ast& ast)
+{
+    m_stats = OptimizerStats{};
+    m_balance.assign(ast.symbolCount(), 0);
+
+    if (ast.root() == NO_NODE) {
+        return m_stats;
+    }
+
+    // Expressions only appear directly below statements; nested ones are
+    // inside GROUPs and are taken care of along with the outer expression.
+    for (NodeId statement = ast.node(ast.root()).firstChild;
+         statement != NO_NODE; statement = ast.node(statement).nextSibling) {
+        for (NodeId child = ast.node(statement).firstChild; child != NO_NODE;
+             child = ast.node(child).nextSibling) {
+            if (ast.node(child).kind == AstNode::Kind::EXPR) {
+                expression(ast, child);
+            }
+        }
+    }
+
+    // Simplifying first can only drop reads, never add them.
+    m_stats.deadStores = eliminateDeadStores(ast);
+
+    return m_stats;
+}
+
+void Optimizer::expression(Ast& ast, NodeId expr)
+{
+    // Collect every operand with its overall sign, taking the operands of
+    // parenthesized expressions in place of the parentheses. Pending operands
+    // are kept last first, so they come off in order.
+    m_terms.clear();
+    m_pending.clear();
+
+    auto push = [this, &ast](NodeId expr, AstNode::Op op) {
+        size_t first = m_pending.size();
+
+        for (NodeId child = ast.node(expr).firstChild; child != NO_NODE;
+             child = ast.node(child).nextSibling) {
+            m_pending.push_back(Term{child, combine(op, ast.node(child).op)});
+        }
+
+        std::reverse(m_pending.begin() + first, m_pending.end());
+    };
+
+    push(expr, AstNode::Op::PLUS);
+
+    while (!m_pending.empty()) {
+        Term term = m_pending.back();
+        m_pending.pop_back();
+
+        const AstNode& node = ast.node(term.node);
+
+        if (node.kind == AstNode::Kind::GROUP) {
+            push(node.firstChild, term.op);
+            m_stats.flattened += 2;
+        } else {
+            m_terms.push_back(term);
+        }
+    }
+
+    // Sum up the constants, and work out how many times each identifier is
+    // added in all.
+    uint64_t constant = 0;
+    NodeId constantNode = NO_NODE;
+    size_t constants = 0;
+
+    for (const Term& term : m_terms) {
+        const AstNode& node = ast.node(term.node);
+
+        if (node.kind == AstNode::Kind::INTEGER) {
+            auto value = static_cast<uint64_t>(ast.integer(term.node));
+            constant = term.op == AstNode::Op::PLUS ? constant + value
+                                                    : constant - value;
+            constantNode = term.node;
+            constants++;
+        } else {
+            m_balance[node.value] += term.op == AstNode::Op::PLUS ? 1 : -1;
+        }
+    }
+
+    if (constants > 1) {
+        m_stats.folded += constants - 1;
+    }
+
+    // Keep as many of each identifier as its balance says, with that sign,
+    // dropping the rest.
+    size_t identifiers = 0;
+
+    for (const Term& term : m_terms) {
+        const AstNode& node = ast.node(term.node);
+        if (node.kind == AstNode::Kind::INTEGER) {
+            continue;
+        }
+
+        int& balance = m_balance[node.value];
+        bool keep = (term.op == AstNode::Op::PLUS && balance > 0) ||
+                    (term.op == AstNode::Op::MINUS && balance < 0);
+
+        if (keep) {
+            balance += term.op == AstNode::Op::PLUS ? -1 : 1;
+            m_terms[identifiers++] = term;
+        } else {
+            m_stats.cancelled++;
+        }
+    }
+    m_terms.resize(identifiers);
+
+    // Every identifier that was kept took its balance back to zero, so the
+    // balances are ready for the next expression.
+
+    // The first identifier that's added leads the expression.
+    size_t first = identifiers;
+    for (size_t i = 0; i < identifiers; i++) {
+        if (m_terms[i].op == AstNode::Op::PLUS) {
+            first = i;
+            break;
+        }
+    }
+
+    // If nothing is added, a constant has to lead instead, so one is made
+    // when there isn't one: everything cancelled out, or every identifier
+    // left is subtracted.
+    if (first == identifiers && constantNode == NO_NODE) {
+        constantNode = ast.addInteger(0, ast.node(expr).offset);
+    }
+
+    // Relink the expression: an added identifier first, if there is one.
+    AstNode& exprNode = ast.node(expr);
+    exprNode.firstChild = NO_NODE;
+    exprNode.lastChild = NO_NODE;
+
+    auto append = [&ast, expr](NodeId node, AstNode::Op op) {
+        ast.node(node).op = op;
+        ast.node(node).nextSibling = NO_NODE;
+        ast.appendChild(expr, node);
+    };
+
+    if (first != identifiers) {
+        append(m_terms[first].node, AstNode::Op::PLUS);
+    } else if (constantNode != NO_NODE) {
+        // Nothing's added, so the constant goes first, even if it's zero.
+        ast.setInteger(constantNode, static_cast<int64_t>(constant));
+        append(constantNode, AstNode::Op::PLUS);
+    }
+
+    for (size_t i = 0; i < identifiers; i++) {
+        if (i != first) {
+            append(m_terms[i].node, m_terms[i].op);
+        }
+    }
+
+    // Add the constant at the end, unless it already went first.
+    if (constantNode == NO_NODE || (first == identifiers)) {
+        return;
+    }
+
+    if (constant == 0) {
+        m_stats.zeros++;
+        return;
+    }
+
+    // Subtract negative constants, so the constant shown is positive.
+    auto value = static_cast<int64_t>(constant);
+
+    if (value < 0) {
+        ast.setInteger(constantNode, static_cast<int64_t>(0 - constant));
+        append(constantNode, AstNode::Op::MINUS);
+    } else {
+        ast.setInteger(constantNode, value);
+        append(constantNode, AstNode::Op::PLUS);
+    }
+}
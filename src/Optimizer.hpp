@@ -0,0 +1,91 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "Ast.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief OptimizerStats counts the nodes each rule of the {@code Optimizer}
+ * removed from a tree.
+ */
+struct OptimizerStats
+{
+    // GROUPs and their EXPRs spliced into the enclosing expression.
+    size_t flattened = 0;
+
+    // Constants combined into another constant.
+    size_t folded = 0;
+
+    // Constants that came to zero, next to other operands.
+    size_t zeros = 0;
+
+    // Identifiers both added and subtracted in the same expression.
+    size_t cancelled = 0;
+
+    // Assignments whose values are never written, see
+    // {@code eliminateDeadStores}.
+    size_t deadStores = 0;
+
+    size_t total() const
+    {
+        return flattened + folded + zeros + cancelled + deadStores;
+    }
+
+    OptimizerStats& operator+=(const OptimizerStats& other);
+};
+
+/**
+ * @brief operator<< prints the statistics one rule per line.
+ */
+std::ostream& operator<<(std::ostream& stream, const OptimizerStats& stats);
+
+/**
+ * @brief Optimizer simplifies the expressions of a parsed program in place.
+ *
+ * Addition and subtraction wrap around, so they're associative and
+ * commutative, and every expression is the sum of its operands, each added or
+ * subtracted. The optimizer rewrites each expression into that form:
+ * parentheses are removed with the signs inside them adjusted, the constants
+ * are summed into one, and an identifier that's both added and subtracted is
+ * dropped. What's left is the first identifier that's added, the other
+ * identifiers in their original order, and then the constant if it isn't
+ * zero. An expression with nothing added starts with the constant instead, so
+ * the first operand is always added.
+ *
+ * Once the expressions are simplified, assignments whose values are never
+ * written are removed.
+ *
+ * Removed nodes are unlinked from the tree but stay in it. Constants may end
+ * up negative.
+ */
+class Optimizer
+{
+public:
+    /**
+     * @brief optimize simplifies every expression in the tree, and removes
+     * dead stores.
+     * @return what was removed
+     */
+    OptimizerStats optimize(Ast& ast);
+
+private:
+    struct Term
+    {
+        NodeId node;
+        AstNode::Op op;
+    };
+
+    void expression(Ast& ast, NodeId expr);
+
+    // Kept between expressions so their storage is reused.
+    std::vector<Term> m_terms;
+    std::vector<Term> m_pending;
+    std::vector<int> m_balance;
+
+    OptimizerStats m_stats;
+};
+
+#endif // OPTIMIZER_HPP
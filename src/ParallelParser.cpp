@@ -0,0 +1,162 @@
+#include "ParallelParser.hpp"
+
+#include "Parser.hpp"
+#include "ThreadPool.hpp"
+#include "Tokenizer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+struct Part
+{
+    size_t begin;
+    size_t end;
+
+    Tokenizer tokenizer;
+    std::unique_ptr<Parser> parser;
+    bool foundEnd = false;
+};
+
+/**
+ * @brief split picks where to split the source: just after a semicolon near
+ * every multiple of {@code size}. The first statement can swallow up to three
+ * semicolons on its own (in place of BEGIN, as a stray token, and its end),
+ * so the first part always holds at least that many.
+ */
+std::vector<size_t> split(const char* data, size_t length, size_t size)
+{
+    std::vector<size_t> bounds{0};
+
+    const char* end = data + length;
+    const char* from = data;
+
+    for (int i = 0; i < 3 && from != end; i++) {
+        auto semicolon =
+            static_cast<const char*>(std::memchr(from, ';', end - from));
+        from = semicolon == nullptr ? end : semicolon + 1;
+    }
+
+    for (size_t target = size; target < length; target += size) {
+        from = std::max(from, data + target);
+        if (from >= end) {
+            break;
+        }
+
+        auto semicolon =
+            static_cast<const char*>(std::memchr(from, ';', end - from));
+        if (semicolon == nullptr || semicolon + 1 == end) {
+            break;
+        }
+
+        from = semicolon + 1;
+        bounds.push_back(from - data);
+    }
+
+    bounds.push_back(length);
+    return bounds;
+}
+} // namespace
+
+ParallelParser::ParallelParser(ThreadPool& pool, size_t minPartSize)
+    : m_pool{pool}
+    , m_minPartSize{minPartSize}
+    , m_parts{0}
+    , m_tokenCounts{}
+{}
+
+bool ParallelParser::parse(const char* data, size_t length)
+{
+    m_ast.clear();
+    m_diagnostics.clear();
+
+    // A few parts per thread keeps them busy when some parts are slower. With
+    // only one thread, splitting would just add work.
+    size_t size = m_pool.size() == 1
+                      ? length
+                      : std::max(m_minPartSize, length / (m_pool.size() * 4) + 1);
+    std::vector<size_t> bounds = split(data, length, size);
+
+    m_parts = bounds.size() - 1;
+    std::vector<Part> parts(m_parts);
+
+    for (size_t i = 0; i < m_parts; i++) {
+        parts[i].begin = bounds[i];
+        parts[i].end = bounds[i + 1];
+    }
+
+    // Every part takes positions from the one index of the whole source,
+    // which is only built if one of them reports an error.
+    LineIndex lines{data, length};
+
+    // Lex and parse every part.
+    for (size_t i = 0; i < m_parts; i++) {
+        m_pool.submit([this, &parts, &lines, i, data] {
+            Part& part = parts[i];
+
+            part.tokenizer.viewSource(data, part.begin, part.end, &lines);
+            part.parser = std::make_unique<Parser>(part.tokenizer);
+            part.foundEnd = part.parser->parsePart(i == 0, i + 1 == m_parts);
+        });
+    }
+    m_pool.wait();
+
+    m_tokenCounts.fill(0);
+    for (const Part& part : parts) {
+        for (size_t type = 0; type < m_tokenCounts.size(); type++) {
+            m_tokenCounts[type] += part.tokenizer.tokenCounts()[type];
+        }
+    }
+
+    // Join the parts in order, up to the first that found END. Symbols are
+    // renumbered by interning every part's names in order, which gives the
+    // same IDs as a sequential parse.
+    SymbolTable symbols;
+    std::vector<const Ast*> trees;
+    std::vector<std::vector<uint32_t>> symbolMaps;
+
+    for (Part& part : parts) {
+        const Ast& ast = part.parser->ast();
+
+        std::vector<uint32_t>& symbolMap = symbolMaps.emplace_back();
+        for (size_t symbol = 0; symbol < ast.symbolCount(); symbol++) {
+            std::string_view name = ast.symbolName(symbol);
+            symbolMap.push_back(symbols.intern(name.data(), name.length()));
+        }
+
+        trees.push_back(&ast);
+
+        for (const Diagnostic& diagnostic :
+             part.parser->diagnostics().diagnostics()) {
+            m_diagnostics.report(diagnostic);
+        }
+
+        if (part.foundEnd) {
+            break;
+        }
+    }
+
+    // A single part's tree is already the whole tree.
+    if (trees.size() == 1) {
+        m_ast = std::move(parts[0].parser->ast());
+        return !m_diagnostics.hasErrors();
+    }
+
+    // The nodes are copied into place in parallel too.
+    m_ast.addNode(AstNode::Kind::PROGRAM,
+                  trees[0]->node(trees[0]->root()).offset);
+    std::vector<Ast::TreeRoom> rooms = m_ast.makeRoom(trees);
+
+    for (size_t i = 0; i < trees.size(); i++) {
+        m_pool.submit([this, &trees, &rooms, &symbolMaps, i] {
+            m_ast.copyTree(*trees[i], rooms[i], symbolMaps[i]);
+        });
+    }
+    m_pool.wait();
+
+    m_ast.importSymbols(symbols);
+
+    return !m_diagnostics.hasErrors();
+}
@@ -0,0 +1,84 @@
+#ifndef PARALLELPARSER_HPP
+#define PARALLELPARSER_HPP
+
+#include "Ast.hpp"
+#include "Diagnostics.hpp"
+#include "Tokenizer.hpp"
+
+#include <cstddef>
+
+class ThreadPool;
+
+/**
+ * @brief ParallelParser parses a single program on several threads.
+ *
+ * Statements can't span a semicolon, so after the first statement, the
+ * parser is always between statements just after a semicolon. The source is
+ * split after semicolons into parts, and every part is lexed and parsed on
+ * its own by {@code Parser::parsePart}, with its own tokenizer and symbol
+ * table. The parts are then joined in order: symbol IDs are renumbered by
+ * first appearance, and anything after a part that found END is dropped.
+ * The tree and the errors are exactly those of a sequential parse.
+ */
+class ParallelParser
+{
+public:
+    // The smallest part worth handing to another thread.
+    static constexpr size_t MIN_PART_SIZE = 64 * 1024;
+
+    /**
+     * @param pool the threads to parse on
+     * @param minPartSize the smallest part to split the source into
+     */
+    ParallelParser(ThreadPool& pool, size_t minPartSize = MIN_PART_SIZE);
+
+    /**
+     * @brief parse parses the whole program in {@code data}, which has to stay
+     * valid for as long as the tree is used.
+     * @return true if the program has no syntax errors
+     */
+    bool parse(const char* data, size_t length);
+
+    const Ast& ast() const
+    {
+        return m_ast;
+    }
+
+    Ast& ast()
+    {
+        return m_ast;
+    }
+
+    const DiagnosticSink& diagnostics() const
+    {
+        return m_diagnostics;
+    }
+
+    /**
+     * @brief parts returns how many parts the last program was split into.
+     */
+    size_t parts() const
+    {
+        return m_parts;
+    }
+
+    /**
+     * @brief tokenCounts returns how many tokens of each type every part read
+     * between them.
+     */
+    const TokenCounts& tokenCounts() const
+    {
+        return m_tokenCounts;
+    }
+
+private:
+    ThreadPool& m_pool;
+    size_t m_minPartSize;
+
+    Ast m_ast;
+    DiagnosticSink m_diagnostics;
+    size_t m_parts;
+    TokenCounts m_tokenCounts;
+};
+
+#endif // PARALLELPARSER_HPP
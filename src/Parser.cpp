@@ -1,73 +1,110 @@
 #include "Parser.hpp"
 
-#include <iostream>
-#include <sstream>
-
-ParserException::ParserException(const std::string& expected,
-                                 const std::string& actual,
-                                 size_t lineNumber,
-                                 size_t columnNumber)
-    : m_expected{expected}
-    , m_actual{actual}
-    , m_lineNumber{lineNumber}
-    , m_columnNumber{columnNumber}
-{}
-
-Parser::Parser(Tokenizer tokenizer)
+Parser::Parser(Tokenizer& tokenizer)
     : m_tokenizer{tokenizer}
 {}
 
-void Parser::parse()
+bool Parser::parse()
 {
-    program();
+    parsePart(true, true);
+
+    return !m_diagnostics.hasErrors();
 }
 
-void Parser::program()
+bool Parser::parsePart(bool first, bool last)
 {
-    Token token = m_tokenizer.nextToken();
+    m_ast.clear();
+    m_diagnostics.clear();
+
+    Token token = m_tokenizer.peekToken();
 
     // Programs are of the form BEGIN <statement list> END
 
-    // Check for BEGIN
-    if (token.data != "BEGIN") {
-        throw ParserException("BEGIN", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
+    NodeId program = m_ast.addNode(AstNode::Kind::PROGRAM, token.offset);
+
+    if (first) {
+        begin();
     }
 
     // Parse the following statement list.
-    statementList();
+    statementList(program, first);
+
+    // Keep the identifier spellings with the tree.
+    m_ast.importSymbols(m_tokenizer.symbols());
+
+    // Check for END. Only the last part has to find it; the others may run
+    // out of tokens first.
+    token = m_tokenizer.peekToken();
+    if (token.keyword == Keyword::END) {
+        m_tokenizer.nextToken();
+        return true;
+    }
 
-    // Check for END
-    token = m_tokenizer.nextToken();
-    if (token.data != "END") {
-        throw ParserException("END", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
+    if (last) {
+        error("END", token);
     }
+
+    return false;
 }
 
-void Parser::statementList()
+void Parser::begin()
 {
-    // Parse a statement
-    statement();
+    Token token = m_tokenizer.peekToken();
+
+    // Check for BEGIN. If it's missing, carry on as though it was there, but
+    // skip over whatever is in its place unless it starts a statement.
+    if (token.keyword != Keyword::BEGIN) {
+        error("BEGIN", token);
 
-    // Parse the tail, or more statements.
-    statementListTail();
+        if (token.keyword != Keyword::READ &&
+            token.keyword != Keyword::WRITE && token.type != Token::Type::TEOF) {
+            m_tokenizer.nextToken();
+        }
+    } else {
+        m_tokenizer.nextToken();
+    }
 }
 
-void Parser::statementListTail()
+void Parser::statementList(NodeId program, bool first)
 {
-    Token token = m_tokenizer.peekToken();
+    // Parse statements for as long as the next token is an identifier, READ,
+    // or WRITE. There's always at least one statement.
+
+    while (true) {
+        Token token = m_tokenizer.peekToken();
+
+        if (first || isStatementStart(token)) {
+            first = false;
 
-    // If the next token is an identifier, READ, or READ, read another statement list.
-    if (token.type == Token::Type::IDENTIFIER || token.data == "READ" ||
-        token.data == "WRITE") {
-        statementList();
+            NodeId node;
+            bool parsed = statement(node);
+            if (parsed) {
+                m_ast.appendChild(program, node);
+            } else {
+                synchronize();
+            }
+
+            if (m_discardTree) {
+                m_discardedStatements += parsed ? 1 : 0;
+                m_ast.clear();
+                program = m_ast.addNode(AstNode::Kind::PROGRAM, token.offset);
+            }
+        } else if (token.keyword == Keyword::END ||
+                   token.type == Token::Type::TEOF) {
+            return;
+        } else {
+            // Anything else can't follow a statement, only END can. Report it
+            // and look for more statements after it.
+            error("END", token);
+            synchronize();
+        }
     }
 }
 
-void Parser::statement()
+bool Parser::statement(NodeId& node)
 {
-    Token token = m_tokenizer.nextToken();
+    Token token = m_tokenizer.peekToken();
+    node = NO_NODE;
 
     // Statements have 3 forms:
     // READ(<idList>);
@@ -77,181 +114,245 @@ void Parser::statement()
     // Check for READ or WRITE.
     if (token.type == Token::Type::KEYWORD) {
         // If we have a READ statement
-        if (token.data == "READ") {
-            // Check for left parenthesis
-            token = m_tokenizer.nextToken();
-            if (token.type != Token::Type::LPAREN) {
-                throw ParserException("left parenthesis",
-                                      Token::TYPE_NAMES[token.type],
-                                      token.lineNumber, token.columnNumber);
-            }
-            // Parse the required id list
-            idList();
-            // Check for right parenthesis
-            token = m_tokenizer.nextToken();
-            if (token.type != Token::Type::RPAREN) {
-                throw ParserException("right parenthesis",
-                                      Token::TYPE_NAMES[token.type],
-                                      token.lineNumber, token.columnNumber);
-            }
-        } else if (token.data == "WRITE") {
-            // Check for left parenthesis
-            token = m_tokenizer.nextToken();
-            if (token.type != Token::Type::LPAREN) {
-                throw ParserException("left parenthesis",
-                                      Token::TYPE_NAMES[token.type],
-                                      token.lineNumber, token.columnNumber);
+        if (token.keyword == Keyword::READ) {
+            m_tokenizer.nextToken();
+            node = m_ast.addNode(AstNode::Kind::READ, token.offset);
+
+            // Check for left parenthesis, the required id list, and the right
+            // parenthesis.
+            if (!expect(Token::Type::LPAREN, "left parenthesis") ||
+                !idList(node) ||
+                !expect(Token::Type::RPAREN, "right parenthesis")) {
+                return false;
             }
-            // Parse the required expr list
-            exprList();
-            // Check for right parenthesis
-            token = m_tokenizer.nextToken();
-            if (token.type != Token::Type::RPAREN) {
-                throw ParserException("right parenthesis",
-                                      Token::TYPE_NAMES[token.type],
-                                      token.lineNumber, token.columnNumber);
+        } else if (token.keyword == Keyword::WRITE) {
+            m_tokenizer.nextToken();
+            node = m_ast.addNode(AstNode::Kind::WRITE, token.offset);
+
+            // Check for left parenthesis, the required expr list, and the
+            // right parenthesis.
+            if (!expect(Token::Type::LPAREN, "left parenthesis") ||
+                !exprList(node) ||
+                !expect(Token::Type::RPAREN, "right parenthesis")) {
+                return false;
             }
         } else {
-            throw ParserException("READ/WRITE", Token::TYPE_NAMES[token.type],
-                                  token.lineNumber, token.columnNumber);
+            error("READ/WRITE", token);
+            return false;
         }
     } else if (token.type == Token::Type::IDENTIFIER) {
-        // We found an identifier, so now we need assignment and expression.
-        token = m_tokenizer.nextToken();
+        m_tokenizer.nextToken();
+        node = m_ast.addNode(AstNode::Kind::ASSIGN, token.offset, token.symbol);
 
-        // Check for assignment
-        if (token.type != Token::Type::ASSIGNMENT) {
-            throw ParserException("assignment", Token::TYPE_NAMES[token.type],
-                                  token.lineNumber, token.columnNumber);
+        // We found an identifier, so now we need assignment and expression.
+        if (!expect(Token::Type::ASSIGNMENT, "assignment")) {
+            return false;
         }
 
         // Parse the expression.
-        expr();
+        NodeId value;
+        if (!expr(value)) {
+            return false;
+        }
+        m_ast.appendChild(node, value);
+    } else {
+        // Not a statement at all. Skip the token, it's reported below as
+        // being where the semicolon should be.
+        m_tokenizer.nextToken();
     }
 
-    token = m_tokenizer.nextToken();
+    token = m_tokenizer.peekToken();
 
-    // Check if this statement ends with a semicolon. If it doesn't, throw an exception.
-    if (token.data != ";") {
-        // If it doesn't, throw an exception.
-        throw ParserException("semicolon", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
+    // Check if this statement ends with a semicolon.
+    if (m_tokenizer.text(token) != ";") {
+        error("semicolon", token);
+        return false;
     }
-}
 
-void Parser::idList()
-{
-    // Check if identifier
-    ident();
-
-    // Look for additional
-    idListTail();
+    m_tokenizer.nextToken();
+    return true;
 }
 
-void Parser::idListTail()
+bool Parser::idList(NodeId parent)
 {
-    Token token = m_tokenizer.peekToken();
+    // Identifiers are separated by commas.
+    while (true) {
+        Token token = m_tokenizer.peekToken();
+
+        // Check if identifier
+        if (token.type != Token::Type::IDENTIFIER) {
+            error("IDENTIFIER", token);
+            return false;
+        }
 
-    if (token.type == Token::Type::SYMBOL && token.data == ",") {
-        // Found comma, so skip the token and grab next identifier list.
         m_tokenizer.nextToken();
+        m_ast.appendChild(parent, m_ast.addNode(AstNode::Kind::IDENTIFIER,
+                                                token.offset, token.symbol));
 
-        // Additional id list is required after comma.
-        idList();
+        // Found comma, so skip it. Another identifier is required after it.
+        if (!isSymbol(m_tokenizer.peekToken(), ",")) {
+            return true;
+        }
+        m_tokenizer.nextToken();
     }
 }
 
-void Parser::exprList()
+bool Parser::exprList(NodeId parent)
 {
-    // Parse expression
-    expr();
+    // Expressions are separated by commas.
+    while (true) {
+        NodeId node;
+        if (!expr(node)) {
+            return false;
+        }
+        m_ast.appendChild(parent, node);
 
-    // Parse additional expressions, if applicable
-    exprListTail();
+        // Found comma, so skip it. Another expression is required after it.
+        if (!isSymbol(m_tokenizer.peekToken(), ",")) {
+            return true;
+        }
+        m_tokenizer.nextToken();
+    }
 }
 
-void Parser::exprListTail()
+bool Parser::expr(NodeId& node)
 {
-    Token token = m_tokenizer.peekToken();
+    // Expressions are <factor> (<op> <factor>)*, where a factor may be a
+    // parenthesized expression. Rather than recursing for parentheses, the
+    // open expressions are kept on m_openExprs and the operands are added to
+    // the innermost one.
+    node = m_ast.addNode(AstNode::Kind::EXPR, m_tokenizer.peekToken().offset);
+
+    m_openExprs.clear();
+    m_openExprs.push_back(node);
+
+    AstNode::Op operation = AstNode::Op::PLUS;
+
+    while (true) {
+        Token token = m_tokenizer.peekToken();
+        NodeId operand;
+
+        if (token.type == Token::Type::LPAREN) {
+            m_tokenizer.nextToken();
+
+            // Open a nested expression and parse its first factor next.
+            operand = m_ast.addNode(AstNode::Kind::GROUP, token.offset);
+            m_ast.node(operand).op = operation;
+            m_ast.appendChild(m_openExprs.back(), operand);
+
+            NodeId inner = m_ast.addNode(AstNode::Kind::EXPR,
+                                         m_tokenizer.peekToken().offset);
+            m_ast.appendChild(operand, inner);
+            m_openExprs.push_back(inner);
+
+            operation = AstNode::Op::PLUS;
+            continue;
+        }
+
+        if (!factor(token, operand)) {
+            return false;
+        }
 
-    // If we find a comma, there's more expression lists.
-    if (token.type == Token::Type::SYMBOL && token.data == ",") {
-        // Found comma, so skip the token and grab next expression list.
         m_tokenizer.nextToken();
+        m_ast.node(operand).op = operation;
+        m_ast.appendChild(m_openExprs.back(), operand);
+
+        // Following an operand, either an operation continues the innermost
+        // expression, or a right parenthesis closes it.
+        while (true) {
+            token = m_tokenizer.peekToken();
+
+            if (token.type == Token::Type::OP) {
+                m_tokenizer.nextToken();
+                operation = op(token);
+                break;
+            }
 
-        // Parse the next expression list.
-        exprList();
+            if (m_openExprs.size() == 1) {
+                return true;
+            }
+
+            // Require right parenthesis.
+            if (!expect(Token::Type::RPAREN, "RPAREN")) {
+                return false;
+            }
+
+            m_openExprs.pop_back();
+        }
     }
 }
 
-void Parser::expr()
+bool Parser::factor(const Token& token, NodeId& node)
 {
-    // Parse a factore
-    factor();
+    // Factors other than parenthesized expressions are an identifier or an
+    // integer.
+    if (token.type == Token::Type::IDENTIFIER) {
+        node = m_ast.addNode(AstNode::Kind::IDENTIFIER, token.offset,
+                             token.symbol);
+    } else if (token.type == Token::Type::INTEGER) {
+        node = m_ast.addInteger(integer(token), token.offset);
+    } else {
+        error("INTEGER or IDENTIFIER", token);
+        return false;
+    }
 
-    // Parse additional expressions, if applicable.
-    exprTail();
+    return true;
 }
 
-void Parser::exprTail()
+bool Parser::expect(Token::Type type, const char* expected)
 {
     Token token = m_tokenizer.peekToken();
 
-    // If we find another operation, there's more exprs.
-    if (token.type == Token::Type::OP) {
-        // Parse the OP.
-        op();
-
-        // Parse the expression
-        expr();
+    if (token.type != type) {
+        error(expected, token);
+        return false;
     }
+
+    m_tokenizer.nextToken();
+    return true;
 }
 
-void Parser::factor()
+void Parser::error(const char* expected, const Token& token)
 {
-    Token token = m_tokenizer.nextToken();
+    // Positions are only worked out for errors.
+    SourcePosition position = m_tokenizer.position(token.offset);
 
-    // Factors start with a left parenthesis, identifier, or integer.
-    // If left parenthesis:
-    if (token.type == Token::Type::LPAREN) {
-        // Parse the following expression
-        expr();
+    m_diagnostics.report(Diagnostic{expected, Token::typeName(token.type),
+                                    position.lineNumber, position.columnNumber,
+                                    token.offset});
+}
 
-        token = m_tokenizer.nextToken();
+void Parser::synchronize()
+{
+    // Panic mode: throw tokens away until the end of the statement.
+    while (true) {
+        Token token = m_tokenizer.peekToken();
 
-        // Require right parenthesis.
-        if (token.type != Token::Type::RPAREN) {
-            throw ParserException("RPAREN", Token::TYPE_NAMES[token.type],
-                                  token.lineNumber, token.columnNumber);
+        if (token.type == Token::Type::TEOF || token.keyword == Keyword::END) {
+            return;
+        }
+
+        m_tokenizer.nextToken();
+
+        if (isSymbol(token, ";")) {
+            return;
         }
-    } else if (token.type == Token::Type::IDENTIFIER) {
-        // Nothing to do, got what we expected
-    } else if (token.type == Token::Type::INTEGER) {
-        // Nothing to do, got what we expected.
-    } else {
-        throw ParserException("INTEGER or IDENTIFIER", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
     }
 }
 
-void Parser::op()
+AstNode::Op Parser::op(const Token& token) const
 {
-    Token token = m_tokenizer.nextToken();
-
-    // If the next token isn't an operation throw an exception.
-    if (token.type != Token::Type::OP) {
-        throw ParserException("OPERATION", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
-    }
+    return m_tokenizer.text(token) == "+" ? AstNode::Op::PLUS
+                                          : AstNode::Op::MINUS;
 }
 
-void Parser::ident()
+int64_t Parser::integer(const Token& token) const
 {
-    Token token = m_tokenizer.nextToken();
+    uint64_t value = 0;
 
-    // If the next token isn't an identifier throw an exception.
-    if (token.type != Token::Type::IDENTIFIER) {
-        throw ParserException("IDENTIFIER", Token::TYPE_NAMES[token.type],
-                              token.lineNumber, token.columnNumber);
+    for (char digit : m_tokenizer.text(token)) {
+        value = value * 10 + (digit - '0');
     }
+
+    return static_cast<int64_t>(value);
 }
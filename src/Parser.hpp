@@ -1,70 +1,156 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include "Ast.hpp"
+#include "Diagnostics.hpp"
 #include "Tokenizer.hpp"
 
-#include <exception>
 #include <string>
 
-class ParserException : public std::exception
+class Parser
 {
 public:
-    ParserException(const std::string& expected,
-                    const std::string& actual,
-                    size_t lineNumber,
-                    size_t columnNumber);
+    Parser(Tokenizer& tokenizer);
+
+    /**
+     * @brief parse parses a whole program and builds its {@code Ast}.
+     * Syntax errors are reported to {@code diagnostics} rather than thrown.
+     * After an error the parser skips ahead to the end of the statement (the
+     * next semicolon, or END) and carries on, so every error in the program
+     * is reported by a single call.
+     * @return true if the program has no syntax errors
+     */
+    bool parse();
+
+    /**
+     * @brief parsePart parses part of a program that was split just after a
+     * semicolon, where no statement is in progress. Parsing the parts in
+     * order gives the same statements and errors as parsing the whole
+     * program, provided the split isn't within the first statement.
+     * @param first whether the part starts the program, so it has to start
+     * with BEGIN and a statement
+     * @param last whether the part ends the program, so it's an error to
+     * reach the end of it without finding END
+     * @return whether END was found, which ends the program no matter what
+     * follows it
+     */
+    bool parsePart(bool first, bool last);
+
+    /**
+     * @brief ast returns the tree built by the last call to {@code parse} or
+     * {@code parsePart}.
+     * Statements with syntax errors are left out of the tree.
+     */
+    const Ast& ast() const
+    {
+        return m_ast;
+    }
 
-    std::string expected() const
+    Ast& ast()
     {
-        return m_expected;
+        return m_ast;
     }
 
-    std::string actual() const
+    const DiagnosticSink& diagnostics() const
     {
-        return m_actual;
+        return m_diagnostics;
     }
 
-    size_t lineNumber() const
+    DiagnosticSink& diagnostics()
     {
-        return m_lineNumber;
+        return m_diagnostics;
     }
 
-    size_t columnNumber() const
+    /**
+     * @brief discardTree has each statement thrown away once it's been
+     * checked, so memory use doesn't grow with the length of the program.
+     * The tree is left with just the program node.
+     */
+    void discardTree(bool discard)
     {
-        return m_columnNumber;
+        m_discardTree = discard;
+    }
+
+    /**
+     * @brief discardedStatements returns how many well formed statements have
+     * been thrown away, as they're no longer in the tree to be counted.
+     */
+    size_t discardedStatements() const
+    {
+        return m_discardedStatements;
     }
 
 private:
-    std::string m_expected;
-    std::string m_actual;
-    size_t m_lineNumber;
-    size_t m_columnNumber;
-};
+    // None of these recurse: lists are parsed with loops, and expressions
+    // keep their own stack of open parentheses. Parsing uses a fixed amount
+    // of call stack no matter how long or deeply nested the input is.
+    //
+    // Each returns false after reporting an error, leaving the parser at the
+    // offending token for {@code synchronize} to skip past.
+    void begin();
+    void statementList(NodeId program, bool first);
+    bool statement(NodeId& node);
+    bool idList(NodeId parent);
+    bool exprList(NodeId parent);
+    bool expr(NodeId& node);
+    bool factor(const Token& token, NodeId& node);
 
-class Parser
-{
-public:
-    Parser(Tokenizer tokenizer);
+    /**
+     * @brief expect consumes the next token if it has the given type.
+     * Otherwise an error is reported and the token is left in place.
+     * @param type the type of token required
+     * @param expected how to describe the token in the error
+     * @return whether or not the token was found
+     */
+    bool expect(Token::Type type, const char* expected);
 
-    void parse();
+    /**
+     * @brief error reports that the parser expected something other than
+     * {@code token}.
+     */
+    void error(const char* expected, const Token& token);
 
-private:
-    void program();
-    void statementList();
-    void statementListTail();
-    void statement();
-    void idList();
-    void idListTail();
-    void exprList();
-    void exprListTail();
-    void expr();
-    void exprTail();
-    void factor();
-    void op();
-    void ident();
+    /**
+     * @brief synchronize skips the rest of a statement after an error: up to
+     * and including the next semicolon, or up to END or the end of the file.
+     */
+    void synchronize();
+
+    /**
+     * @brief isStatementStart returns whether a token can begin a statement.
+     */
+    static bool isStatementStart(const Token& token)
+    {
+        return token.type == Token::Type::IDENTIFIER ||
+               token.keyword == Keyword::READ ||
+               token.keyword == Keyword::WRITE;
+    }
+
+    bool isSymbol(const Token& token, const char* symbol) const
+    {
+        return token.type == Token::Type::SYMBOL &&
+               m_tokenizer.text(token) == symbol;
+    }
+
+    AstNode::Op op(const Token& token) const;
+
+    /**
+     * @brief integer converts the text of an INTEGER token to its value.
+     * Constants too large for 64 bits wrap around.
+     */
+    int64_t integer(const Token& token) const;
 
 private:
-    Tokenizer m_tokenizer;
+    Tokenizer& m_tokenizer;
+    Ast m_ast;
+    DiagnosticSink m_diagnostics;
+
+    // The expressions {@code expr} has open, innermost last. Kept between
+    // calls so its storage is reused.
+    std::vector<NodeId> m_openExprs;
+
+    bool m_discardTree = false;
+    size_t m_discardedStatements = 0;
 };
 
 #endif // PARSER_HPP
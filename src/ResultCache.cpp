@@ -0,0 +1,258 @@
+#include "ResultCache.hpp"
+
+#include "Hash.hpp"
+#include "MappedFile.hpp"
+#include "ResultCodec.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#define HAVE_FLOCK 1
+#endif
+
+#ifndef COMPILER_VERSION
+#define COMPILER_VERSION "unknown"
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// "RESCACHE" read as a little endian number.
+const uint64_t MAGIC = 0x4548434143534552ull;
+
+// Bumped whenever the layout changes.
+const uint32_t VERSION = 2;
+
+struct Header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t payloadLength;
+    uint64_t checksum;
+};
+
+/**
+ * @brief Lock holds an exclusive lock on a file for its lifetime, keeping
+ * other processes that lock the same file out. Without flock it does
+ * nothing.
+ */
+class Lock
+{
+public:
+    explicit Lock(const std::string& fileName)
+    {
+#if HAVE_FLOCK
+        m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if (m_fd >= 0) {
+            ::flock(m_fd, LOCK_EX);
+        }
+#else
+        (void)fileName;
+#endif
+    }
+
+    ~Lock()
+    {
+#if HAVE_FLOCK
+        if (m_fd >= 0) {
+            ::flock(m_fd, LOCK_UN);
+            ::close(m_fd);
+        }
+#endif
+    }
+
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+
+private:
+#if HAVE_FLOCK
+    int m_fd;
+#endif
+};
+} // namespace
+
+std::string ResultCache::temporaryName(const std::string& fileName)
+{
+    std::string name = fileName + ".tmp";
+
+#if HAVE_FLOCK
+    name += std::to_string(::getpid()) + "-";
+#endif
+
+    return name +
+           std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+ResultCache::ResultCache(std::string directory)
+    : m_directory{std::move(directory)}
+{}
+
+uint64_t ResultCache::key(const char* source,
+                          size_t length,
+                          const CompileOptions& options)
+{
+    // Only the options that change what's in a result are part of the key.
+    std::string salt = COMPILER_VERSION;
+    salt += options.optimize ? 'O' : '-';
+    salt += options.dumpAst ? 'A' : '-';
+    salt += options.dumpIr ? 'I' : '-';
+    salt += options.bytecode || options.dumpBytecode ? 'B' : '-';
+    salt += options.warnings ? 'W' : '-';
+
+    return hash64(source, length, hash64(salt.data(), salt.length()));
+}
+
+bool ResultCache::load(uint64_t key, CompileResult& result) const
+{
+    std::string fileName = path(key);
+    MappedFile file;
+
+    if (!file.open(fileName) || file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const char* payload = file.data() + sizeof(Header);
+
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.key != key ||
+        header.payloadLength != file.size() - sizeof(Header) ||
+        header.checksum != hash64(payload, header.payloadLength)) {
+        return false;
+    }
+
+    CompileResult loaded;
+
+    if (!ResultCodec::decode(payload, static_cast<size_t>(header.payloadLength),
+                             loaded)) {
+        return false;
+    }
+
+    // Eviction goes by modification time, so a hit makes the result the most
+    // recently used.
+    std::error_code error;
+    fs::last_write_time(fileName, fs::file_time_type::clock::now(), error);
+
+    // The stats are the caller's, of this run.
+    loaded.stats = std::move(result.stats);
+    result = std::move(loaded);
+    return true;
+}
+
+bool ResultCache::store(uint64_t key, const CompileResult& result) const
+{
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+
+    std::string payload;
+    ResultCodec::encode(result, payload);
+
+    Header header{MAGIC,
+                  VERSION,
+                  0,
+                  key,
+                  payload.length(),
+                  hash64(payload.data(), payload.length())};
+
+    std::string fileName = path(key);
+    std::string temporary = temporaryName(fileName);
+
+    {
+        std::ofstream stream{temporary, std::ios::binary | std::ios::trunc};
+        if (!stream.is_open()) {
+            return false;
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(payload.data(),
+                     static_cast<std::streamsize>(payload.length()));
+
+        if (!stream.flush()) {
+            stream.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), fileName.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void ResultCache::trim(uint64_t maxBytes) const
+{
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+
+    std::error_code error;
+    if (!fs::is_directory(m_directory, error)) {
+        return;
+    }
+
+    // Other processes may be trimming too; let one at a time decide what
+    // goes. Stores and loads don't take the lock, as a result removed under
+    // them is simply a miss.
+    Lock lock{(fs::path{m_directory} / "lock").string()};
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    for (fs::directory_iterator it{m_directory, error}, end;
+         !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ".res") {
+            continue;
+        }
+
+        std::error_code entryError;
+        Entry entry{it->path(), it->file_size(entryError),
+                    it->last_write_time(entryError)};
+
+        if (!entryError) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+
+        fs::remove(entry.path, error);
+        total -= entry.size;
+    }
+}
+
+std::string ResultCache::path(uint64_t key) const
+{
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.res",
+                  static_cast<unsigned long long>(key));
+
+    return (fs::path{m_directory} / name).string();
+}
@@ -0,0 +1,65 @@
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include "Driver.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief ResultCache keeps the outcome of compiling a file in a directory, so
+ * a file that was compiled before with the same options is never parsed
+ * again. Each result is a file of its own, named after its key.
+ *
+ * Any number of processes can share a directory. Results are written under a
+ * temporary name and renamed into place, so a result is either whole or
+ * missing, and every result carries a checksum, so a damaged one is just a
+ * miss. Trimming the directory is serialized by a lock file.
+ */
+class ResultCache
+{
+public:
+    explicit ResultCache(std::string directory);
+
+    /**
+     * @brief temporaryName returns a name to write a file under before
+     * renaming it into place, unique to the calling process and thread. Every
+     * file written that way uses it.
+     */
+    static std::string temporaryName(const std::string& fileName);
+
+    /**
+     * @brief key identifies the result of compiling a source: its hash, the
+     * compiler version and the options that change the result.
+     */
+    static uint64_t key(const char* source,
+                        size_t length,
+                        const CompileOptions& options);
+
+    /**
+     * @brief load reads a cached result, and marks it as recently used.
+     * @return false if there's no intact result for the key
+     */
+    bool load(uint64_t key, CompileResult& result) const;
+
+    /**
+     * @brief store saves a result, creating the directory if needed. Stats
+     * aren't saved, as they describe a single run.
+     * @return false if the result couldn't be written
+     */
+    bool store(uint64_t key, const CompileResult& result) const;
+
+    /**
+     * @brief trim removes the least recently used results until the ones left
+     * take up at most maxBytes.
+     */
+    void trim(uint64_t maxBytes) const;
+
+private:
+    std::string path(uint64_t key) const;
+
+    std::string m_directory;
+};
+
+#endif // RESULTCACHE_HPP
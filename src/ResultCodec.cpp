@@ -0,0 +1,299 @@
+#include "ResultCodec.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief Writer appends values to a buffer in the machine's byte order.
+ */
+class Writer
+{
+public:
+    explicit Writer(std::string& data)
+        : m_data{data}
+    {}
+
+    template <typename T>
+    void value(T value)
+    {
+        m_data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void string(const std::string& text)
+    {
+        value<uint64_t>(text.length());
+        m_data += text;
+    }
+
+private:
+    std::string& m_data;
+};
+
+/**
+ * @brief Reader takes values back out of a buffer. Reading past the end
+ * fails the reader rather than the program; every later read fails too.
+ */
+class Reader
+{
+public:
+    Reader(const char* data, size_t length)
+        : m_data{data}
+        , m_end{data + length}
+        , m_ok{true}
+    {}
+
+    template <typename T>
+    T value()
+    {
+        T value{};
+
+        if (!m_ok || static_cast<size_t>(m_end - m_data) < sizeof(value)) {
+            m_ok = false;
+            return value;
+        }
+
+        std::memcpy(&value, m_data, sizeof(value));
+        m_data += sizeof(value);
+        return value;
+    }
+
+    std::string string()
+    {
+        uint64_t length = value<uint64_t>();
+
+        if (!m_ok || static_cast<uint64_t>(m_end - m_data) < length) {
+            m_ok = false;
+            return std::string{};
+        }
+
+        std::string text{m_data, static_cast<size_t>(length)};
+        m_data += length;
+        return text;
+    }
+
+    /**
+     * @brief count reads the length of an array of items at least itemSize
+     * bytes each, failing if that many couldn't be left to read.
+     */
+    size_t count(size_t itemSize)
+    {
+        uint64_t count = value<uint64_t>();
+
+        if (!m_ok ||
+            count > static_cast<uint64_t>(m_end - m_data) / itemSize) {
+            m_ok = false;
+            return 0;
+        }
+
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief done returns true if every read succeeded and nothing is left.
+     */
+    bool done() const
+    {
+        return m_ok && m_data == m_end;
+    }
+
+private:
+    const char* m_data;
+    const char* m_end;
+    bool m_ok;
+};
+
+/**
+ * @brief wellFormed returns whether bytecode can be run without reading or
+ * writing outside its registers and constants: every operand is in range,
+ * READ only reads into variables, and the code ends in HALT. Bytecode that
+ * wasn't asked for has no code at all, and is left alone.
+ */
+bool wellFormed(const Bytecode& bytecode)
+{
+    const std::vector<Instruction>& code = bytecode.code();
+    uint64_t registers = bytecode.registers();
+    uint64_t constants = bytecode.constants().size();
+
+    if (code.empty()) {
+        return true;
+    }
+
+    if (code.back().opcode != Opcode::HALT ||
+        bytecode.variables() > registers) {
+        return false;
+    }
+
+    for (const Instruction& instruction : code) {
+        bool ok = true;
+
+        switch (instruction.opcode) {
+        case Opcode::LOADK:
+            ok = instruction.a < registers && instruction.b < constants;
+            break;
+        case Opcode::MOVE:
+            ok = instruction.a < registers && instruction.b < registers;
+            break;
+        case Opcode::ADD:
+        case Opcode::SUB:
+            ok = instruction.a < registers && instruction.b < registers &&
+                 instruction.c < registers;
+            break;
+        case Opcode::ADDK:
+        case Opcode::SUBK:
+            ok = instruction.a < registers && instruction.b < registers &&
+                 instruction.c < constants;
+            break;
+        case Opcode::READ:
+            ok = instruction.a < bytecode.variables();
+            break;
+        case Opcode::WRITE:
+            ok = static_cast<uint64_t>(instruction.a) + instruction.b <=
+                 registers;
+            break;
+        case Opcode::HALT:
+            break;
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+void ResultCodec::encode(const CompileResult& result, std::string& buffer)
+{
+    Writer writer{buffer};
+
+    writer.value<uint32_t>(static_cast<uint32_t>(result.status));
+
+    writer.value<uint64_t>(result.diagnostics.size());
+    for (const Diagnostic& diagnostic : result.diagnostics) {
+        writer.string(diagnostic.expected);
+        writer.string(diagnostic.actual);
+        writer.value<uint64_t>(diagnostic.lineNumber);
+        writer.value<uint64_t>(diagnostic.columnNumber);
+        writer.value<uint64_t>(diagnostic.offset);
+        writer.value<uint8_t>(static_cast<uint8_t>(diagnostic.severity));
+        writer.string(diagnostic.message);
+    }
+
+    const OptimizerStats& optimizerStats = result.optimizerStats;
+    writer.value<uint64_t>(optimizerStats.flattened);
+    writer.value<uint64_t>(optimizerStats.folded);
+    writer.value<uint64_t>(optimizerStats.zeros);
+    writer.value<uint64_t>(optimizerStats.cancelled);
+    writer.value<uint64_t>(optimizerStats.deadStores);
+
+    writer.string(result.ast);
+    writer.string(result.ir);
+
+    const Bytecode& bytecode = result.bytecode;
+
+    writer.value<uint64_t>(bytecode.m_code.size());
+    for (const Instruction& instruction : bytecode.m_code) {
+        writer.value<uint8_t>(static_cast<uint8_t>(instruction.opcode));
+        writer.value<uint32_t>(instruction.a);
+        writer.value<uint32_t>(instruction.b);
+        writer.value<uint32_t>(instruction.c);
+    }
+
+    writer.value<uint64_t>(bytecode.m_constants.size());
+    for (int64_t constant : bytecode.m_constants) {
+        writer.value<int64_t>(constant);
+    }
+
+    writer.value<uint32_t>(bytecode.m_registers);
+
+    writer.value<uint64_t>(bytecode.m_names.size());
+    for (const std::string& name : bytecode.m_names) {
+        writer.string(name);
+    }
+
+    writer.value<uint64_t>(bytecode.m_statements);
+}
+
+bool ResultCodec::decode(const char* data,
+                         size_t length,
+                         CompileResult& result)
+{
+    Reader reader{data, length};
+
+    uint32_t status = reader.value<uint32_t>();
+    if (status > static_cast<uint32_t>(CompileResult::Status::UNREADABLE)) {
+        return false;
+    }
+    result.status = static_cast<CompileResult::Status>(status);
+
+    // The smallest diagnostic has three empty strings.
+    result.diagnostics.resize(reader.count(6 * sizeof(uint64_t) + 1));
+    for (Diagnostic& diagnostic : result.diagnostics) {
+        diagnostic.expected = reader.string();
+        diagnostic.actual = reader.string();
+        diagnostic.lineNumber = reader.value<uint64_t>();
+        diagnostic.columnNumber = reader.value<uint64_t>();
+        diagnostic.offset = reader.value<uint64_t>();
+
+        uint8_t severity = reader.value<uint8_t>();
+        if (severity > static_cast<uint8_t>(Diagnostic::Severity::WARNING)) {
+            return false;
+        }
+        diagnostic.severity = static_cast<Diagnostic::Severity>(severity);
+        diagnostic.message = reader.string();
+    }
+
+    OptimizerStats& optimizerStats = result.optimizerStats;
+    optimizerStats.flattened = reader.value<uint64_t>();
+    optimizerStats.folded = reader.value<uint64_t>();
+    optimizerStats.zeros = reader.value<uint64_t>();
+    optimizerStats.cancelled = reader.value<uint64_t>();
+    optimizerStats.deadStores = reader.value<uint64_t>();
+
+    result.ast = reader.string();
+    result.ir = reader.string();
+
+    Bytecode& bytecode = result.bytecode;
+
+    bytecode.m_code.resize(reader.count(13));
+    for (Instruction& instruction : bytecode.m_code) {
+        uint8_t opcode = reader.value<uint8_t>();
+        if (opcode > static_cast<uint8_t>(Opcode::HALT)) {
+            return false;
+        }
+
+        instruction.opcode = static_cast<Opcode>(opcode);
+        instruction.a = reader.value<uint32_t>();
+        instruction.b = reader.value<uint32_t>();
+        instruction.c = reader.value<uint32_t>();
+    }
+
+    bytecode.m_constants.resize(reader.count(sizeof(int64_t)));
+    for (int64_t& constant : bytecode.m_constants) {
+        constant = reader.value<int64_t>();
+    }
+
+    bytecode.m_registers = reader.value<uint32_t>();
+
+    bytecode.m_names.resize(reader.count(sizeof(uint64_t)));
+    for (std::string& name : bytecode.m_names) {
+        name = reader.string();
+    }
+
+    bytecode.m_statements = reader.value<uint64_t>();
+
+    // The checksum of a cache entry, or a reply arriving whole, doesn't mean
+    // the bytecode is safe to run.
+    return reader.done() && wellFormed(bytecode);
+}
+
+bool ResultCodec::hasBytecode(const CompileResult& result,
+                              const CompileOptions& options)
+{
+    return !(options.bytecode || options.dumpBytecode) ||
+           result.status != CompileResult::Status::COMPILED ||
+           !result.bytecode.code().empty();
+}
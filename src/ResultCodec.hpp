@@ -0,0 +1,40 @@
+#ifndef RESULTCODEC_HPP
+#define RESULTCODEC_HPP
+
+#include "Driver.hpp"
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief ResultCodec turns a {@code CompileResult} into bytes and back, for
+ * keeping results in a {@code ResultCache} and sending them to a
+ * {@code Client}. Values are in the machine's byte order. Stats aren't
+ * included, as they describe a single run.
+ */
+class ResultCodec
+{
+public:
+    /**
+     * @brief encode appends a result to a buffer.
+     */
+    static void encode(const CompileResult& result, std::string& buffer);
+
+    /**
+     * @brief decode reads a result that takes up all of [data, data + length).
+     * Bytecode is checked to stay within its registers and constants, so it
+     * can be run as it is.
+     * @return false if it isn't a whole, well formed result
+     */
+    static bool decode(const char* data, size_t length, CompileResult& result);
+
+    /**
+     * @brief hasBytecode returns whether a decoded result has the bytecode
+     * the options ask for. {@code decode} can't tell on its own, as a file
+     * compiled without bytecode rightly has none.
+     */
+    static bool hasBytecode(const CompileResult& result,
+                            const CompileOptions& options);
+};
+
+#endif // RESULTCODEC_HPP
@@ -0,0 +1,436 @@
+#include "Scan.hpp"
+
+#include "CharClass.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SCAN_SSE2 1
+#if defined(__GNUC__)
+// AVX2 code is compiled per function, so the rest of the build doesn't
+// require it and the CPU is checked before it's used.
+#define SCAN_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace scan
+{
+namespace
+{
+#ifdef SCAN_SSE2
+inline unsigned int firstSetBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Each class is tested over a whole vector at once: the result has every bit
+// of a lane set where the byte is in the class.
+
+struct Whitespace
+{
+    static bool test(char c)
+    {
+        return classify(c) == CharClass::WHITESPACE;
+    }
+
+#ifdef SCAN_SSE2
+    static __m128i test(__m128i v)
+    {
+        // ' ', or '\t' through '\r' which are contiguous.
+        __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+        __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+        __m128i control = _mm_cmpeq_epi8(
+            _mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+        return _mm_or_si128(space, control);
+    }
+#endif
+
+#ifdef SCAN_AVX2
+    TARGET_AVX2 static __m256i test(__m256i v)
+    {
+        __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+        __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+        __m256i control = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+        return _mm256_or_si256(space, control);
+    }
+#endif
+};
+
+struct Digits
+{
+    static bool test(char c)
+    {
+        return classify(c) == CharClass::DIGIT;
+    }
+
+#ifdef SCAN_SSE2
+    static __m128i test(__m128i v)
+    {
+        __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(9)),
+                              shifted);
+    }
+#endif
+
+#ifdef SCAN_AVX2
+    TARGET_AVX2 static __m256i test(__m256i v)
+    {
+        __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(9)),
+                                 shifted);
+    }
+#endif
+};
+
+struct IdentifierTail
+{
+    static bool test(char c)
+    {
+        return isIdentifierTail(c);
+    }
+
+#ifdef SCAN_SSE2
+    static __m128i test(__m128i v)
+    {
+        // Setting bit 5 folds upper case letters onto lower case ones.
+        __m128i folded = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                                      _mm_set1_epi8('a'));
+        __m128i letters = _mm_cmpeq_epi8(
+            _mm_min_epu8(folded, _mm_set1_epi8('z' - 'a')), folded);
+        __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(letters, underscore),
+                            Digits::test(v));
+    }
+#endif
+
+#ifdef SCAN_AVX2
+    TARGET_AVX2 static __m256i test(__m256i v)
+    {
+        __m256i folded = _mm256_sub_epi8(
+            _mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i letters = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(folded, _mm256_set1_epi8('z' - 'a')), folded);
+        __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+        return _mm256_or_si256(_mm256_or_si256(letters, underscore),
+                               Digits::test(v));
+    }
+#endif
+};
+
+// Line breaks are found a vector at a time too, as a mask with a bit set for
+// every \n.
+
+size_t countNewlinesScalar(const char* begin, const char* end)
+{
+    size_t count = 0;
+
+    for (; begin != end; begin++) {
+        count += *begin == '\n' ? 1 : 0;
+    }
+
+    return count;
+}
+
+void findLineStartsScalar(const char* data,
+                          size_t from,
+                          size_t length,
+                          std::vector<uint32_t>& starts)
+{
+    for (size_t i = from; i < length; i++) {
+        if (data[i] == '\n') {
+            starts.push_back(static_cast<uint32_t>(i + 1));
+        }
+    }
+}
+
+#ifdef SCAN_SSE2
+inline unsigned int popCount(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    return __popcnt(mask);
+#else
+    return __builtin_popcount(mask);
+#endif
+}
+
+unsigned int newlineMask(const char* p)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+}
+
+size_t countNewlinesSse2(const char* begin, const char* end)
+{
+    size_t count = 0;
+
+    for (; end - begin >= 16; begin += 16) {
+        count += popCount(newlineMask(begin));
+    }
+
+    return count + countNewlinesScalar(begin, end);
+}
+
+void findLineStartsSse2(const char* data,
+                        size_t from,
+                        size_t length,
+                        std::vector<uint32_t>& starts)
+{
+    size_t i = from;
+
+    for (; length - i >= 16; i += 16) {
+        // Most blocks hold no line break at all.
+        for (unsigned int mask = newlineMask(data + i); mask != 0;
+             mask &= mask - 1) {
+            starts.push_back(static_cast<uint32_t>(i + firstSetBit(mask) + 1));
+        }
+    }
+
+    findLineStartsScalar(data, i, length, starts);
+}
+#endif
+
+#ifdef SCAN_AVX2
+TARGET_AVX2 unsigned int newlineMaskAvx2(const char* p)
+{
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return static_cast<unsigned int>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+}
+
+TARGET_AVX2 size_t countNewlinesAvx2(const char* begin, const char* end)
+{
+    size_t count = 0;
+
+    for (; end - begin >= 32; begin += 32) {
+        count += popCount(newlineMaskAvx2(begin));
+    }
+
+    return count + countNewlinesSse2(begin, end);
+}
+
+TARGET_AVX2 void findLineStartsAvx2(const char* data,
+                                    size_t from,
+                                    size_t length,
+                                    std::vector<uint32_t>& starts)
+{
+    size_t i = from;
+
+    for (; length - i >= 32; i += 32) {
+        for (unsigned int mask = newlineMaskAvx2(data + i); mask != 0;
+             mask &= mask - 1) {
+            starts.push_back(static_cast<uint32_t>(i + firstSetBit(mask) + 1));
+        }
+    }
+
+    findLineStartsSse2(data, i, length, starts);
+}
+#endif
+
+template <typename Class>
+const char* skipScalar(const char* begin, const char* end)
+{
+    while (begin != end && Class::test(*begin)) {
+        begin++;
+    }
+
+    return begin;
+}
+
+#ifdef SCAN_SSE2
+template <typename Class>
+const char* skipSse2(const char* begin, const char* end)
+{
+    while (end - begin >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        unsigned int outside = ~_mm_movemask_epi8(Class::test(v)) & 0xFFFF;
+
+        if (outside != 0) {
+            return begin + firstSetBit(outside);
+        }
+
+        begin += 16;
+    }
+
+    return skipScalar<Class>(begin, end);
+}
+#endif
+
+#ifdef SCAN_AVX2
+template <typename Class>
+TARGET_AVX2 const char* skipAvx2(const char* begin, const char* end)
+{
+    while (end - begin >= 32) {
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        unsigned int outside = ~_mm256_movemask_epi8(Class::test(v));
+
+        if (outside != 0) {
+            return begin + firstSetBit(outside);
+        }
+
+        begin += 32;
+    }
+
+    // Finish the tail with the narrower kernel.
+    return skipSse2<Class>(begin, end);
+}
+#endif
+
+using Kernel = const char* (*)(const char*, const char*);
+using CountKernel = size_t (*)(const char*, const char*);
+using LineStartsKernel = void (*)(const char*,
+                                  size_t,
+                                  size_t,
+                                  std::vector<uint32_t>&);
+
+struct Kernels
+{
+    Level level;
+    Kernel whitespace;
+    Kernel identifierTail;
+    Kernel digits;
+    CountKernel newlines;
+    LineStartsKernel lineStarts;
+};
+
+template <template <typename> class Skip>
+Kernels makeKernels(Level level,
+                    CountKernel newlines,
+                    LineStartsKernel lineStarts)
+{
+    return Kernels{level,
+                   Skip<Whitespace>::run,
+                   Skip<IdentifierTail>::run,
+                   Skip<Digits>::run,
+                   newlines,
+                   lineStarts};
+}
+
+template <typename Class>
+struct Scalar
+{
+    static const char* run(const char* begin, const char* end)
+    {
+        return skipScalar<Class>(begin, end);
+    }
+};
+
+#ifdef SCAN_SSE2
+template <typename Class>
+struct Sse2
+{
+    static const char* run(const char* begin, const char* end)
+    {
+        return skipSse2<Class>(begin, end);
+    }
+};
+#endif
+
+#ifdef SCAN_AVX2
+template <typename Class>
+struct Avx2
+{
+    static const char* run(const char* begin, const char* end)
+    {
+        return skipAvx2<Class>(begin, end);
+    }
+};
+#endif
+
+Level bestSupported()
+{
+#ifdef SCAN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return Level::AVX2;
+    }
+#endif
+#ifdef SCAN_SSE2
+    return Level::SSE2;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+Kernels kernelsFor(Level level)
+{
+#ifdef SCAN_AVX2
+    if (level == Level::AVX2) {
+        return makeKernels<Avx2>(Level::AVX2, countNewlinesAvx2,
+                                 findLineStartsAvx2);
+    }
+#endif
+#ifdef SCAN_SSE2
+    if (level >= Level::SSE2) {
+        return makeKernels<Sse2>(Level::SSE2, countNewlinesSse2,
+                                 findLineStartsSse2);
+    }
+#endif
+    return makeKernels<Scalar>(Level::SCALAR, countNewlinesScalar,
+                               findLineStartsScalar);
+}
+
+Kernels kernels = kernelsFor(bestSupported());
+} // namespace
+
+Level level()
+{
+    return kernels.level;
+}
+
+Level setLevel(Level level)
+{
+    if (level > bestSupported()) {
+        level = bestSupported();
+    }
+
+    kernels = kernelsFor(level);
+    return kernels.level;
+}
+
+const char* levelName(Level level)
+{
+    switch (level) {
+    case Level::AVX2:
+        return "AVX2";
+    case Level::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+const char* skipWhitespace(const char* begin, const char* end)
+{
+    return kernels.whitespace(begin, end);
+}
+
+const char* skipIdentifierTail(const char* begin, const char* end)
+{
+    return kernels.identifierTail(begin, end);
+}
+
+const char* skipDigits(const char* begin, const char* end)
+{
+    return kernels.digits(begin, end);
+}
+
+size_t countNewlines(const char* begin, const char* end)
+{
+    return kernels.newlines(begin, end);
+}
+
+void findLineStarts(const char* data,
+                    size_t length,
+                    std::vector<uint32_t>& starts)
+{
+    kernels.lineStarts(data, 0, length, starts);
+}
+} // namespace scan
@@ -0,0 +1,70 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Vectorized kernels for finding the end of a run of one character class,
+ * and for finding line breaks.
+ * The widest implementation the CPU supports is picked at startup, falling
+ * back to plain loops where SSE2 and AVX2 aren't available.
+ */
+namespace scan
+{
+enum class Level
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+/**
+ * @brief level returns the implementation the kernels currently use.
+ */
+Level level();
+
+/**
+ * @brief setLevel switches the kernels to the given implementation, or the
+ * best supported one below it. Only intended for benchmarking and testing.
+ * @param level the implementation to use
+ * @return the implementation actually selected
+ */
+Level setLevel(Level level);
+
+const char* levelName(Level level);
+
+/**
+ * @brief skipWhitespace returns the first byte in [begin, end) that isn't
+ * whitespace, or {@code end} if the whole range is.
+ */
+const char* skipWhitespace(const char* begin, const char* end);
+
+/**
+ * @brief skipIdentifierTail returns the first byte in [begin, end) that can't
+ * continue an identifier, or {@code end}.
+ */
+const char* skipIdentifierTail(const char* begin, const char* end);
+
+/**
+ * @brief skipDigits returns the first byte in [begin, end) that isn't a
+ * decimal digit, or {@code end}.
+ */
+const char* skipDigits(const char* begin, const char* end);
+
+/**
+ * @brief countNewlines returns how many \n there are in [begin, end).
+ */
+size_t countNewlines(const char* begin, const char* end);
+
+/**
+ * @brief findLineStarts appends the offset just past every \n in
+ * [data, data + length) to {@code starts}, in order.
+ */
+void findLineStarts(const char* data,
+                    size_t length,
+                    std::vector<uint32_t>& starts);
+} // namespace scan
+
+#endif // SCAN_HPP
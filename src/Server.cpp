@@ -0,0 +1,562 @@
+#include "Server.hpp"
+
+#include "ResultCodec.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define HAVE_UNIX_SOCKETS 1
+#else
+#define HAVE_UNIX_SOCKETS 0
+#endif
+
+namespace
+{
+// "CSRV" read as a little endian number. Requests and replies both start
+// with it, so talking to something that isn't a server fails cleanly.
+const uint32_t MAGIC = 0x56525343;
+
+enum class RequestKind : uint32_t
+{
+    // The payload is the name of a file.
+    COMPILE_FILE,
+    // The payload is the source itself.
+    COMPILE_SOURCE,
+    STOP,
+};
+
+// The options of a request. Everything else is the server's.
+const uint32_t OPTIMIZE = 1u << 0;
+const uint32_t DUMP_AST = 1u << 1;
+const uint32_t DUMP_IR = 1u << 2;
+const uint32_t BYTECODE = 1u << 3;
+const uint32_t WARNINGS = 1u << 4;
+
+struct RequestHeader
+{
+    uint32_t magic;
+    RequestKind kind;
+    uint32_t options;
+    uint32_t reserved;
+    uint64_t length;
+};
+
+// Followed by length bytes of encoded result; none for STOP.
+struct ResponseHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t length;
+};
+
+#if !HAVE_UNIX_SOCKETS
+const char* UNSUPPORTED = "Unix domain sockets aren't supported here.";
+#endif
+
+#if HAVE_UNIX_SOCKETS
+// A peer that has gone away shouldn't kill the process with SIGPIPE.
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// How long a client may take over sending the rest of a request once it's
+// started one, or over taking a reply, before the worker gives up on it.
+const time_t TRANSFER_TIMEOUT_SECONDS = 10;
+
+bool readAll(int fd, void* data, size_t length)
+{
+    auto* p = static_cast<char*>(data);
+
+    while (length > 0) {
+        ssize_t count = ::recv(fd, p, length, 0);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+
+        p += count;
+        length -= static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t length)
+{
+    const auto* p = static_cast<const char*>(data);
+
+    while (length > 0) {
+        ssize_t count = ::send(fd, p, length, SEND_FLAGS);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+
+        p += count;
+        length -= static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    // The path has to fit with its terminator.
+    if (path.empty() || path.length() >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    std::memcpy(address.sun_path, path.data(), path.length());
+    return true;
+}
+
+/**
+ * @brief connectTo opens a connection to a socket.
+ * @return the connection, or -1 with the reason in errno
+ */
+int connectTo(const std::string& path)
+{
+    sockaddr_un address;
+    if (!makeAddress(path, address)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                  sizeof(address)) != 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+
+    return fd;
+}
+#endif
+} // namespace
+
+Server::Server(CompileOptions options, unsigned jobs)
+    : m_options{options}
+    , m_listener{-1}
+    , m_wake{-1, -1}
+    , m_stopping{false}
+    , m_pool{jobs}
+{
+    // Connections are served in parallel already, and nothing is timed.
+    m_options.parallel = false;
+    m_options.stats = false;
+}
+
+Server::~Server()
+{
+#if HAVE_UNIX_SOCKETS
+    if (m_listener >= 0) {
+        ::close(m_listener);
+        ::unlink(m_path.c_str());
+    }
+
+    for (int fd : m_wake) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+bool Server::supported()
+{
+    return HAVE_UNIX_SOCKETS;
+}
+
+bool Server::listen(const std::string& socketPath)
+{
+#if HAVE_UNIX_SOCKETS
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        m_error = "Invalid socket path " + socketPath + ".";
+        return false;
+    }
+
+    // Only a socket nothing answers on is left over; don't take over from a
+    // server that's running.
+    int existing = connectTo(socketPath);
+    if (existing >= 0) {
+        ::close(existing);
+        m_error = "A server is already listening on " + socketPath + ".";
+        return false;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        m_error = std::strerror(errno);
+        return false;
+    }
+
+    ::unlink(socketPath.c_str());
+
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0) {
+        m_error = "Unable to listen on " + socketPath + ": " +
+                  std::strerror(errno) + ".";
+        ::close(fd);
+        return false;
+    }
+
+    // Neither end of the pipe blocks: a full pipe already means a wake is
+    // pending, and an empty one means there's nothing more to drain.
+    if (m_wake[0] < 0 && (::pipe(m_wake) != 0 ||
+                          ::fcntl(m_wake[0], F_SETFL, O_NONBLOCK) != 0 ||
+                          ::fcntl(m_wake[1], F_SETFL, O_NONBLOCK) != 0)) {
+        m_error = std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    m_listener = fd;
+    m_path = socketPath;
+    m_stopping = false;
+    return true;
+#else
+    (void)socketPath;
+    m_error = UNSUPPORTED;
+    return false;
+#endif
+}
+
+void Server::serve()
+{
+#if HAVE_UNIX_SOCKETS
+    // Connections waiting for their next request. Those with a request being
+    // answered are left out until it has been.
+    std::vector<int> idle;
+    std::vector<int> answered;
+    std::vector<pollfd> watched;
+
+    while (!m_stopping) {
+        watched.clear();
+        watched.push_back(pollfd{m_wake[0], POLLIN, 0});
+        watched.push_back(pollfd{m_listener, POLLIN, 0});
+        for (int connection : idle) {
+            watched.push_back(pollfd{connection, POLLIN, 0});
+        }
+
+        if (::poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (watched[0].revents != 0) {
+            char drained[64];
+            while (::read(m_wake[0], drained, sizeof(drained)) > 0) {
+            }
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            answered.swap(m_answered);
+        }
+
+        if (m_stopping) {
+            break;
+        }
+
+        // A request has started to arrive, or the client has gone; either way
+        // a worker reads what there is.
+        size_t kept = 0;
+
+        for (size_t i = 0; i < idle.size(); i++) {
+            int connection = idle[i];
+
+            if (watched[i + 2].revents == 0) {
+                idle[kept++] = connection;
+                continue;
+            }
+
+            m_pool.submit([this, connection] {
+                bool open = answer(connection);
+
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (open) {
+                    m_answered.push_back(connection);
+                } else {
+                    m_connections.erase(connection);
+                    ::close(connection);
+                }
+                wake();
+            });
+        }
+
+        // Connections whose request has been answered are watched again from
+        // the next pass on.
+        idle.resize(kept);
+        idle.insert(idle.end(), answered.begin(), answered.end());
+        answered.clear();
+
+        if (watched[1].revents == 0) {
+            continue;
+        }
+
+        int connection = ::accept(m_listener, nullptr, nullptr);
+
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        ::setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+        timeval timeout{TRANSFER_TIMEOUT_SECONDS, 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                     sizeof(timeout));
+        ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                     sizeof(timeout));
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_connections.insert(connection);
+        idle.push_back(connection);
+    }
+
+    // Clients may still be sending requests. Shutting their connections down
+    // ends the reads the workers are waiting in.
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (int connection : m_connections) {
+            ::shutdown(connection, SHUT_RDWR);
+        }
+    }
+
+    m_pool.wait();
+
+    // What's left is every connection that was waiting for a request.
+    for (int connection : m_connections) {
+        ::close(connection);
+    }
+    m_connections.clear();
+    m_answered.clear();
+
+    ::close(m_listener);
+    ::unlink(m_path.c_str());
+    m_listener = -1;
+#endif
+}
+
+bool Server::answer(int connection)
+{
+#if HAVE_UNIX_SOCKETS
+    RequestHeader request;
+
+    // Sources are limited to 4 GiB, like files.
+    if (!readAll(connection, &request, sizeof(request)) ||
+        request.magic != MAGIC || request.kind > RequestKind::STOP ||
+        request.length > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    std::string payload(static_cast<size_t>(request.length), '\0');
+    if (!readAll(connection, payload.data(), payload.size())) {
+        return false;
+    }
+
+    if (request.kind == RequestKind::STOP) {
+        ResponseHeader header{MAGIC, 0, 0};
+        writeAll(connection, &header, sizeof(header));
+        stop();
+        return false;
+    }
+
+    CompileOptions options = m_options;
+    options.optimize = (request.options & OPTIMIZE) != 0;
+    options.dumpAst = (request.options & DUMP_AST) != 0;
+    options.dumpIr = (request.options & DUMP_IR) != 0;
+    options.bytecode = (request.options & BYTECODE) != 0;
+    options.warnings = (request.options & WARNINGS) != 0;
+    options.dumpBytecode = false;
+
+    CompileResult result = request.kind == RequestKind::COMPILE_FILE
+                               ? compileFile(payload, options)
+                               : compileSource("<source>", payload, options);
+
+    // The header goes in front of the result, so the reply is one send.
+    std::string reply(sizeof(ResponseHeader), '\0');
+    ResultCodec::encode(result, reply);
+
+    ResponseHeader header{MAGIC, 0, reply.size() - sizeof(ResponseHeader)};
+    std::memcpy(&reply[0], &header, sizeof(header));
+
+    return writeAll(connection, reply.data(), reply.size());
+#else
+    (void)connection;
+    return false;
+#endif
+}
+
+void Server::wake()
+{
+#if HAVE_UNIX_SOCKETS
+    char signal = 0;
+    while (::write(m_wake[1], &signal, 1) < 0 && errno == EINTR) {
+    }
+#endif
+}
+
+void Server::stop()
+{
+#if HAVE_UNIX_SOCKETS
+    m_stopping = true;
+    wake();
+#endif
+}
+
+Client::Client()
+    : m_socket{-1}
+{}
+
+Client::~Client()
+{
+#if HAVE_UNIX_SOCKETS
+    if (m_socket >= 0) {
+        ::close(m_socket);
+    }
+#endif
+}
+
+bool Client::connect(const std::string& socketPath)
+{
+#if HAVE_UNIX_SOCKETS
+    if (m_socket >= 0) {
+        ::close(m_socket);
+    }
+
+    m_socket = connectTo(socketPath);
+    if (m_socket < 0) {
+        m_error = "Unable to connect to " + socketPath + ": " +
+                  std::strerror(errno) + ".";
+        return false;
+    }
+
+    return true;
+#else
+    (void)socketPath;
+    m_error = UNSUPPORTED;
+    return false;
+#endif
+}
+
+bool Client::compileFile(const std::string& fileName,
+                         const CompileOptions& options,
+                         CompileResult& result)
+{
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute(fileName, error);
+
+    return request(static_cast<uint32_t>(RequestKind::COMPILE_FILE), options,
+                   error ? fileName : path.string(), &result);
+}
+
+bool Client::compileSource(std::string_view source,
+                           const CompileOptions& options,
+                           CompileResult& result)
+{
+    return request(static_cast<uint32_t>(RequestKind::COMPILE_SOURCE), options,
+                   source, &result);
+}
+
+bool Client::stop()
+{
+    return request(static_cast<uint32_t>(RequestKind::STOP), CompileOptions{},
+                   std::string_view{}, nullptr);
+}
+
+bool Client::request(uint32_t kind,
+                     const CompileOptions& options,
+                     std::string_view payload,
+                     CompileResult* result)
+{
+#if HAVE_UNIX_SOCKETS
+    if (m_socket < 0) {
+        m_error = "Not connected to a server.";
+        return false;
+    }
+
+    uint32_t flags = 0;
+    flags |= options.optimize ? OPTIMIZE : 0;
+    flags |= options.dumpAst ? DUMP_AST : 0;
+    flags |= options.dumpIr ? DUMP_IR : 0;
+    flags |= options.bytecode || options.dumpBytecode ? BYTECODE : 0;
+    flags |= options.warnings ? WARNINGS : 0;
+
+    RequestHeader header{MAGIC, static_cast<RequestKind>(kind), flags, 0,
+                         payload.size()};
+
+    std::string message(sizeof(header), '\0');
+    std::memcpy(&message[0], &header, sizeof(header));
+    message.append(payload.data(), payload.size());
+
+    ResponseHeader reply;
+
+    if (!writeAll(m_socket, message.data(), message.size()) ||
+        !readAll(m_socket, &reply, sizeof(reply)) || reply.magic != MAGIC) {
+        m_error = "The server didn't answer.";
+        return false;
+    }
+
+    std::string body(static_cast<size_t>(reply.length), '\0');
+
+    if (!readAll(m_socket, &body[0], body.size())) {
+        m_error = "The server didn't answer.";
+        return false;
+    }
+
+    if (result != nullptr &&
+        (!ResultCodec::decode(body.data(), body.size(), *result) ||
+         !ResultCodec::hasBytecode(*result, options))) {
+        m_error = "The server's answer was malformed.";
+        return false;
+    }
+
+    return true;
+#else
+    (void)kind;
+    (void)options;
+    (void)payload;
+    (void)result;
+    m_error = UNSUPPORTED;
+    return false;
+#endif
+}
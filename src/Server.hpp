@@ -0,0 +1,159 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "Driver.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Server compiles files for {@code Client}s in other processes, over a
+ * Unix domain socket. It stays up between compiles, so a compile costs
+ * neither process startup nor cold caches.
+ *
+ * A connection can send any number of requests in turn. Connections waiting
+ * for their next request are watched from the thread running {@code serve},
+ * and each request is answered by one of a fixed set of worker threads, so an
+ * idle connection doesn't hold a worker. A request names a file or carries
+ * the source itself, along with the output options it wants. The reply is the
+ * whole {@code CompileResult}, apart from stats, encoded by
+ * {@code ResultCodec}.
+ *
+ * Only platforms with Unix domain sockets are supported. Elsewhere
+ * {@code listen} always fails.
+ */
+class Server
+{
+public:
+    /**
+     * @param options what every file is compiled with, apart from the output
+     * options, which each request chooses for itself
+     * @param jobs how many requests to answer at once, or 0 for one per
+     * hardware thread
+     */
+    Server(CompileOptions options, unsigned jobs = 0);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    static bool supported();
+
+    /**
+     * @brief listen creates the socket, replacing any left behind by a server
+     * that didn't shut down cleanly.
+     * @return false if the socket couldn't be created, with the reason in
+     * {@code error}
+     */
+    bool listen(const std::string& socketPath);
+
+    /**
+     * @brief serve accepts connections until a client asks the server to
+     * stop, then closes every connection and removes the socket.
+     */
+    void serve();
+
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+private:
+    /**
+     * @brief answer reads and answers one request on a connection. A client
+     * that stops partway through a request times out.
+     * @return whether the connection is still open for another request
+     */
+    bool answer(int connection);
+
+    /**
+     * @brief wake has {@code serve} look again at what it's waiting for.
+     */
+    void wake();
+
+    /**
+     * @brief stop makes {@code serve} return.
+     */
+    void stop();
+
+    CompileOptions m_options;
+
+    std::string m_path;
+    int m_listener;
+
+    // A pipe written to by wake, so the thread running serve notices.
+    int m_wake[2];
+
+    std::atomic<bool> m_stopping;
+
+    // Open connections, so they can be closed when the server stops, and
+    // those whose request has been answered, to be watched for the next.
+    std::mutex m_mutex;
+    std::set<int> m_connections;
+    std::vector<int> m_answered;
+
+    std::string m_error;
+
+    // Last, so the workers have stopped before anything they use goes.
+    ThreadPool m_pool;
+};
+
+/**
+ * @brief Client sends compile requests to a {@code Server}. The requests on a
+ * connection are answered in order.
+ */
+class Client
+{
+public:
+    Client();
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    bool connect(const std::string& socketPath);
+
+    /**
+     * @brief compileFile has the server compile a file. Relative names are
+     * made absolute first, as the server's working directory may differ.
+     * @return false if the server couldn't be asked or didn't answer, with
+     * the reason in {@code error}
+     */
+    bool compileFile(const std::string& fileName,
+                     const CompileOptions& options,
+                     CompileResult& result);
+
+    /**
+     * @brief compileSource has the server compile source held in memory.
+     */
+    bool compileSource(std::string_view source,
+                       const CompileOptions& options,
+                       CompileResult& result);
+
+    /**
+     * @brief stop asks the server to stop. It answers before it goes.
+     */
+    bool stop();
+
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+private:
+    bool request(uint32_t kind,
+                 const CompileOptions& options,
+                 std::string_view payload,
+                 CompileResult* result);
+
+    int m_socket;
+
+    std::string m_error;
+};
+
+#endif // SERVER_HPP
@@ -0,0 +1,289 @@
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// Counted by operator new below. Each thread has its own, so counting needs
+// no synchronization.
+thread_local uint64_t t_allocations = 0;
+thread_local uint64_t t_allocatedBytes = 0;
+
+const char* COUNTER_NAMES[] = {"bytes read",       "statements",
+                               "diagnostics",      "token cache hits",
+                               "result cache hits"};
+
+/**
+ * @brief writeJsonString writes a string as a JSON string literal.
+ */
+void writeJsonString(std::ostream& stream, const std::string& text)
+{
+    stream << '"';
+
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            stream << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            stream << escape;
+        } else {
+            stream << c;
+        }
+    }
+
+    stream << '"';
+}
+
+// Trace timestamps are in microseconds, kept to the nanosecond.
+std::string micros(double seconds)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", seconds * 1e6);
+    return text;
+}
+} // namespace
+
+// Every allocation goes through here, so that it can be counted.
+void* operator new(std::size_t size)
+{
+    t_allocations++;
+    t_allocatedBytes += size;
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    while (true) {
+        if (void* memory = std::malloc(size)) {
+            return memory;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+Stats::Timer::Timer(Stats* stats, Phase phase)
+    : m_stats{stats}
+    , m_phase{phase}
+    , m_start{0}
+    , m_allocations{0}
+    , m_allocatedBytes{0}
+{
+    if (m_stats != nullptr) {
+        m_start = now();
+        m_allocations = t_allocations;
+        m_allocatedBytes = t_allocatedBytes;
+    }
+}
+
+Stats::Timer::~Timer()
+{
+    if (m_stats == nullptr) {
+        return;
+    }
+
+    Event event{m_phase, m_start, now() - m_start,
+                t_allocations - m_allocations,
+                t_allocatedBytes - m_allocatedBytes};
+
+    PhaseTotals& totals = m_stats->m_phases[static_cast<size_t>(m_phase)];
+    totals.runs++;
+    totals.seconds += event.duration;
+    totals.allocations += event.allocations;
+    totals.allocatedBytes += event.allocatedBytes;
+
+    m_stats->m_events.push_back(event);
+}
+
+void Stats::addTokens(const TokenCounts& tokens)
+{
+    for (size_t i = 0; i < tokens.size(); i++) {
+        m_tokens[i] += tokens[i];
+    }
+}
+
+Stats& Stats::operator+=(const Stats& other)
+{
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        m_phases[i].runs += other.m_phases[i].runs;
+        m_phases[i].seconds += other.m_phases[i].seconds;
+        m_phases[i].allocations += other.m_phases[i].allocations;
+        m_phases[i].allocatedBytes += other.m_phases[i].allocatedBytes;
+    }
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        m_counters[i] += other.m_counters[i];
+    }
+
+    addTokens(other.m_tokens);
+
+    return *this;
+}
+
+void Stats::print(std::ostream& stream) const
+{
+    double total = 0;
+    for (const PhaseTotals& totals : m_phases) {
+        total += totals.seconds;
+    }
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-12s %6s %12s %7s %12s %14s\n",
+                  "Phase", "Runs", "Time (ms)", "%", "Allocations",
+                  "Bytes");
+    stream << line;
+
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        const PhaseTotals& totals = m_phases[i];
+
+        if (totals.runs == 0) {
+            continue;
+        }
+
+        std::snprintf(line, sizeof(line),
+                      "%-12s %6llu %12.3f %6.1f%% %12llu %14llu\n",
+                      phaseName(static_cast<Phase>(i)),
+                      static_cast<unsigned long long>(totals.runs),
+                      totals.seconds * 1e3,
+                      total > 0 ? totals.seconds / total * 100 : 0.0,
+                      static_cast<unsigned long long>(totals.allocations),
+                      static_cast<unsigned long long>(totals.allocatedBytes));
+        stream << line;
+    }
+
+    std::snprintf(line, sizeof(line), "%-12s %6s %12.3f\n", "total", "",
+                  total * 1e3);
+    stream << line;
+
+    auto counter = [&](const std::string& name, uint64_t value) {
+        std::snprintf(line, sizeof(line), "%-24s %14llu\n", name.c_str(),
+                      static_cast<unsigned long long>(value));
+        stream << line;
+    };
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        counter(COUNTER_NAMES[i], m_counters[i]);
+    }
+
+    for (size_t i = 0; i < m_tokens.size(); i++) {
+        if (m_tokens[i] != 0) {
+            auto type = static_cast<Token::Type>(i);
+            counter(std::string{"tokens "} + Token::typeName(type), m_tokens[i]);
+        }
+    }
+}
+
+const char* Stats::phaseName(Phase phase)
+{
+    static const char* NAMES[] = {"load",     "cache",    "parse",
+                                  "analyze",  "optimize", "dump ast",
+                                  "lower ir", "bytecode", "format",
+                                  "run"};
+
+    return NAMES[static_cast<size_t>(phase)];
+}
+
+double Stats::now()
+{
+    static const auto EPOCH = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - EPOCH;
+    return elapsed.count();
+}
+
+uint64_t Stats::allocations()
+{
+    return t_allocations;
+}
+
+uint64_t Stats::allocatedBytes()
+{
+    return t_allocatedBytes;
+}
+
+void writeTrace(std::ostream& stream, const std::vector<TraceTrack>& tracks)
+{
+    stream << "{\"traceEvents\":[";
+
+    bool first = true;
+    auto separate = [&] {
+        stream << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const TraceTrack& track = tracks[i];
+        const std::vector<Stats::Event>& events = track.stats->events();
+        size_t tid = i + 1;
+
+        separate();
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+               << tid << ",\"args\":{\"name\":";
+        writeJsonString(stream, track.name);
+        stream << "}}";
+
+        if (events.empty()) {
+            continue;
+        }
+
+        // A span around the whole file, carrying its counters.
+        double start = events.front().start;
+        double end = start;
+        for (const Stats::Event& event : events) {
+            start = std::min(start, event.start);
+            end = std::max(end, event.start + event.duration);
+        }
+
+        separate();
+        stream << "{\"name\":\"compile\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+               << ",\"ts\":" << micros(start)
+               << ",\"dur\":" << micros(end - start) << ",\"args\":{";
+
+        const Stats& stats = *track.stats;
+        for (size_t c = 0; c < Stats::COUNTER_COUNT; c++) {
+            stream << (c == 0 ? "" : ",") << '"' << COUNTER_NAMES[c]
+                   << "\":" << stats.m_counters[c];
+        }
+        for (size_t t = 0; t < stats.m_tokens.size(); t++) {
+            if (stats.m_tokens[t] != 0) {
+                stream << ",";
+                auto type = static_cast<Token::Type>(t);
+                writeJsonString(stream, std::string{"tokens "} +
+                                            Token::typeName(type));
+                stream << ":" << stats.m_tokens[t];
+            }
+        }
+        stream << "}}";
+
+        for (const Stats::Event& event : events) {
+            separate();
+            stream << "{\"name\":\"" << Stats::phaseName(event.phase)
+                   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                   << ",\"ts\":" << micros(event.start)
+                   << ",\"dur\":" << micros(event.duration)
+                   << ",\"args\":{\"allocations\":" << event.allocations
+                   << ",\"allocated bytes\":" << event.allocatedBytes << "}}";
+        }
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
@@ -0,0 +1,168 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include "Tokenizer.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TraceTrack;
+
+/**
+ * @brief Stats records where the time went while compiling a file: the wall
+ * time and allocations of each phase, and counts of what was processed. Every
+ * phase that runs is also kept as an event, for {@code writeTrace}.
+ *
+ * Allocations are counted per thread by the global operator new, so a phase
+ * only sees what its own thread allocated.
+ */
+class Stats
+{
+public:
+    enum class Phase : uint8_t
+    {
+        LOAD,
+        // Looking up and storing results in a ResultCache.
+        CACHE,
+        // Lexing happens on demand as the parser asks for tokens, so it's
+        // part of this phase.
+        PARSE,
+        // Dataflow analyses run for warnings.
+        ANALYZE,
+        OPTIMIZE,
+        DUMP_AST,
+        LOWER_IR,
+        BYTECODE,
+        // Turning results and diagnostics into text.
+        FORMAT,
+        RUN,
+    };
+
+    static constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::RUN) + 1;
+
+    enum class Counter : uint8_t
+    {
+        BYTES_READ,
+        STATEMENTS,
+        DIAGNOSTICS,
+        TOKEN_CACHE_HITS,
+        RESULT_CACHE_HITS,
+    };
+
+    static constexpr size_t COUNTER_COUNT =
+        static_cast<size_t>(Counter::RESULT_CACHE_HITS) + 1;
+
+    struct Event
+    {
+        Phase phase;
+
+        // In seconds since {@code now} was first called.
+        double start;
+        double duration;
+
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+    };
+
+    /**
+     * @brief Timer records a phase from its construction to its destruction.
+     * It does nothing if given no stats, so it can be left in place when
+     * stats aren't wanted.
+     */
+    class Timer
+    {
+    public:
+        Timer(Stats* stats, Phase phase);
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        Stats* m_stats;
+        Phase m_phase;
+
+        double m_start;
+        uint64_t m_allocations;
+        uint64_t m_allocatedBytes;
+    };
+
+    void add(Counter counter, uint64_t value)
+    {
+        m_counters[static_cast<size_t>(counter)] += value;
+    }
+
+    void addTokens(const TokenCounts& tokens);
+
+    /**
+     * @brief operator+= adds another file's totals to these. Events aren't
+     * merged; they stay with the file they happened in.
+     */
+    Stats& operator+=(const Stats& other);
+
+    const std::vector<Event>& events() const
+    {
+        return m_events;
+    }
+
+    /**
+     * @brief print writes a table of the phases followed by the counters.
+     */
+    void print(std::ostream& stream) const;
+
+    static const char* phaseName(Phase phase);
+
+    /**
+     * @brief now returns the seconds since it was first called, the time
+     * base of every event.
+     */
+    static double now();
+
+    /**
+     * @brief allocations returns how many allocations the calling thread has
+     * made, and allocatedBytes their total size.
+     */
+    static uint64_t allocations();
+    static uint64_t allocatedBytes();
+
+private:
+    friend void writeTrace(std::ostream& stream,
+                           const std::vector<TraceTrack>& tracks);
+
+    struct PhaseTotals
+    {
+        uint64_t runs;
+        double seconds;
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+    };
+
+    std::array<PhaseTotals, PHASE_COUNT> m_phases{};
+    std::array<uint64_t, COUNTER_COUNT> m_counters{};
+    TokenCounts m_tokens{};
+
+    std::vector<Event> m_events;
+};
+
+/**
+ * @brief TraceTrack is one row of a trace, named after the file it shows.
+ */
+struct TraceTrack
+{
+    std::string name;
+    const Stats* stats;
+};
+
+/**
+ * @brief writeTrace writes the events of every track in the Chrome trace event
+ * format, which chrome://tracing and Perfetto can show. Each file is a track
+ * of its own, with the phases inside a span for the whole file that carries
+ * its counters.
+ */
+void writeTrace(std::ostream& stream, const std::vector<TraceTrack>& tracks);
+
+#endif // STATS_HPP
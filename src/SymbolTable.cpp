@@ -0,0 +1,120 @@
+#include "SymbolTable.hpp"
+
+#include "CharClass.hpp"
+
+namespace
+{
+const size_t INITIAL_SLOTS = 256;
+} // namespace
+
+SymbolTable::SymbolTable()
+    : m_slots(INITIAL_SLOTS, Slot{0, NONE})
+{}
+
+uint32_t SymbolTable::intern(const char* text, size_t length)
+{
+    uint32_t textHash = hash(text, length);
+    size_t mask = m_slots.size() - 1;
+
+    for (size_t i = textHash & mask;; i = (i + 1) & mask) {
+        Slot& slot = m_slots[i];
+
+        if (slot.id == NONE) {
+            // Not found, so store the folded spelling and take the next ID.
+            char* name = static_cast<char*>(m_arena.allocate(length, 1));
+            for (size_t j = 0; j < length; j++) {
+                name[j] = foldCase(text[j]);
+            }
+
+            uint32_t id = static_cast<uint32_t>(m_names.size());
+            m_names.emplace_back(name, length);
+            slot = Slot{textHash, id};
+
+            // Keep the load factor at or below one half.
+            if (m_names.size() * 2 > m_slots.size()) {
+                grow();
+            }
+
+            return id;
+        }
+
+        if (slot.hash == textHash && equals(slot.id, text, length)) {
+            return slot.id;
+        }
+    }
+}
+
+uint32_t SymbolTable::find(const char* text, size_t length) const
+{
+    uint32_t textHash = hash(text, length);
+    size_t mask = m_slots.size() - 1;
+
+    for (size_t i = textHash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = m_slots[i];
+
+        if (slot.id == NONE) {
+            return NONE;
+        }
+
+        if (slot.hash == textHash && equals(slot.id, text, length)) {
+            return slot.id;
+        }
+    }
+}
+
+void SymbolTable::clear()
+{
+    m_slots.assign(INITIAL_SLOTS, Slot{0, NONE});
+    m_names.clear();
+    m_arena.clear();
+}
+
+uint32_t SymbolTable::hash(const char* text, size_t length)
+{
+    // FNV-1a over the case folded identifier.
+    uint32_t value = 2166136261u;
+
+    for (size_t i = 0; i < length; i++) {
+        value ^= static_cast<unsigned char>(foldCase(text[i]));
+        value *= 16777619u;
+    }
+
+    return value;
+}
+
+bool SymbolTable::equals(uint32_t id, const char* text, size_t length) const
+{
+    std::string_view name = m_names[id];
+
+    if (name.length() != length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (foldCase(text[i]) != name[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SymbolTable::grow()
+{
+    std::vector<Slot> slots(m_slots.size() * 2, Slot{0, NONE});
+    size_t mask = slots.size() - 1;
+
+    for (const Slot& slot : m_slots) {
+        if (slot.id == NONE) {
+            continue;
+        }
+
+        size_t i = slot.hash & mask;
+        while (slots[i].id != NONE) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+
+    m_slots.swap(slots);
+}
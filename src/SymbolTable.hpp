@@ -0,0 +1,81 @@
+#ifndef SYMBOLTABLE_HPP
+#define SYMBOLTABLE_HPP
+
+#include "Arena.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief SymbolTable interns identifiers, mapping each distinct identifier to
+ * a dense integer ID. IDs are handed out in order of first appearance
+ * starting at zero, so later stages can index plain arrays by them.
+ *
+ * Identifiers are case insensitive: they're folded to upper case before being
+ * stored, and {@code name} returns the folded spelling.
+ */
+class SymbolTable
+{
+public:
+    // Returned by {@code find} for identifiers that haven't been interned.
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    SymbolTable();
+
+    /**
+     * @brief intern returns the ID of an identifier, adding it if it's new.
+     * @param text the identifier, in any case
+     * @param length the length of the identifier
+     * @return the identifier's ID
+     */
+    uint32_t intern(const char* text, size_t length);
+
+    /**
+     * @brief find returns the ID of an identifier without adding it.
+     * @return the identifier's ID, or {@code NONE} if it hasn't been interned
+     */
+    uint32_t find(const char* text, size_t length) const;
+
+    /**
+     * @brief name returns the upper case spelling of an interned identifier.
+     */
+    std::string_view name(uint32_t id) const
+    {
+        return m_names[id];
+    }
+
+    size_t size() const
+    {
+        return m_names.size();
+    }
+
+    /**
+     * @brief clear forgets every identifier. IDs start from zero again.
+     */
+    void clear();
+
+private:
+    // Slots are empty when id is NONE. The full hash is kept so the table can
+    // be grown without rehashing the names, and to skip most comparisons.
+    struct Slot
+    {
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    static uint32_t hash(const char* text, size_t length);
+
+    bool equals(uint32_t id, const char* text, size_t length) const;
+
+    void grow();
+
+    // Open addressing with linear probing; the size is a power of two.
+    std::vector<Slot> m_slots;
+
+    // The spellings, indexed by ID, stored in the arena.
+    std::vector<std::string_view> m_names;
+    Arena m_arena;
+};
+
+#endif // SYMBOLTABLE_HPP
@@ -0,0 +1,143 @@
+#include "ThreadPool.hpp"
+
+namespace
+{
+// The index of the pool worker running on this thread, if any.
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local unsigned currentWorker = 0;
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads)
+    : m_queued{0}
+    , m_pending{0}
+    , m_next{0}
+    , m_stopping{false}
+{
+    if (threads == 0) {
+        threads = defaultSize();
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned index;
+
+    // Count the task before it's visible, so a worker that takes it straight
+    // away never sees the counts go negative.
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_queued++;
+        m_pending++;
+
+        if (currentPool == this) {
+            index = currentWorker;
+        } else {
+            index = m_next;
+            m_next = (m_next + 1) % m_queues.size();
+        }
+    }
+
+    {
+        Queue& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+unsigned ThreadPool::defaultSize()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+void ThreadPool::run(unsigned index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+
+    while (true) {
+        if (take(index, task)) {
+            task();
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (--m_pending == 0) {
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to take. Sleep until something is queued, then look again;
+        // it may have been counted but not pushed yet, or taken by another
+        // worker first.
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_wake.wait(lock, [this] { return m_queued > 0 || m_stopping; });
+
+        if (m_stopping && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::take(unsigned index, std::function<void()>& task)
+{
+    size_t count = m_queues.size();
+
+    for (size_t i = 0; i < count; i++) {
+        Queue& queue = *m_queues[(index + i) % count];
+        std::unique_lock<std::mutex> lock{queue.mutex};
+
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        // Newest first from our own queue, oldest first when stealing.
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        lock.unlock();
+
+        std::lock_guard<std::mutex> countLock{m_mutex};
+        m_queued--;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,95 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ThreadPool runs tasks on a fixed set of worker threads.
+ *
+ * Every worker has a queue of its own. Tasks submitted from outside the pool
+ * are dealt out to the queues in turn, and tasks submitted by a worker go on
+ * that worker's queue. Workers take their newest task first, and when their
+ * own queue is empty they steal the oldest task from another queue, so the
+ * work stays balanced however unevenly long the tasks are.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Starts the workers.
+     * @param threads the number of workers, or 0 for one per hardware thread
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * @brief Finishes every submitted task, then stops the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief submit queues a task to be run by one of the workers.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief wait blocks until every submitted task has finished.
+     */
+    void wait();
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(m_threads.size());
+    }
+
+    /**
+     * @brief defaultSize returns the number of hardware threads, or 1 if it
+     * isn't known.
+     */
+    static unsigned defaultSize();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(unsigned index);
+
+    /**
+     * @brief take removes a task for worker {@code index} to run: the newest
+     * of its own, or else the oldest of another worker's.
+     * @return whether or not a task was found
+     */
+    bool take(unsigned index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // Guards the counts below; workers sleep on m_wake while there's nothing
+    // queued, and wait() sleeps on m_idle until nothing is pending.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+
+    // Tasks sitting in a queue, and tasks queued or running.
+    size_t m_queued;
+    size_t m_pending;
+
+    // Where the next task from outside the pool goes.
+    unsigned m_next;
+
+    bool m_stopping;
+};
+
+#endif // THREADPOOL_HPP
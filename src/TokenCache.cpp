@@ -0,0 +1,191 @@
+#include "TokenCache.hpp"
+
+#include "ResultCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+// "TOKCACHE" read as a little endian number. A file written on a machine of
+// the other byte order doesn't match.
+const uint64_t MAGIC = 0x45484341434B4F54ull;
+
+// Bumped whenever the layout changes.
+const uint32_t VERSION = 2;
+
+struct Header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceLength;
+    uint64_t hash;
+    uint64_t tokens;
+    uint64_t symbols;
+    uint64_t namesLength;
+};
+
+/**
+ * @brief fileSize returns how long a cache with these counts is: the header,
+ * the 32-bit arrays (three per token, and one more than there are symbols for
+ * the name offsets), the 8-bit arrays and the names.
+ */
+uint64_t fileSize(uint64_t tokens, uint64_t symbols, uint64_t namesLength)
+{
+    return sizeof(Header) + 4 * (3 * tokens + symbols + 1) + 2 * tokens +
+           namesLength;
+}
+
+template <typename T>
+void writeArray(std::ofstream& stream, const std::vector<T>& values)
+{
+    stream.write(reinterpret_cast<const char*>(values.data()),
+                 static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+} // namespace
+
+TokenCache::TokenCache()
+    : m_tokens{0}
+    , m_symbolCount{0}
+    , m_offsets{nullptr}
+    , m_lengths{nullptr}
+    , m_symbols{nullptr}
+    , m_types{nullptr}
+    , m_keywords{nullptr}
+    , m_nameOffsets{nullptr}
+    , m_names{nullptr}
+{}
+
+bool TokenCache::write(const std::string& fileName,
+                       uint64_t hash,
+                       size_t sourceLength,
+                       const TokenBuffer& tokens,
+                       const SymbolTable& symbols)
+{
+    std::vector<uint32_t> nameOffsets{0};
+    std::string names;
+
+    for (size_t i = 0; i < symbols.size(); i++) {
+        names += symbols.name(static_cast<uint32_t>(i));
+        nameOffsets.push_back(static_cast<uint32_t>(names.length()));
+    }
+
+    Header header{MAGIC,          VERSION,        0,
+                  sourceLength,   hash,           tokens.size(),
+                  symbols.size(), names.length()};
+
+    // Named for the writing process and thread, so that two writers of the
+    // same cache don't share a temporary file.
+    std::string temporary = ResultCache::temporaryName(fileName);
+
+    {
+        std::ofstream stream{temporary, std::ios::binary | std::ios::trunc};
+        if (!stream.is_open()) {
+            return false;
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(stream, tokens.m_offsets);
+        writeArray(stream, tokens.m_lengths);
+        writeArray(stream, tokens.m_symbols);
+        writeArray(stream, nameOffsets);
+        writeArray(stream, tokens.m_types);
+        writeArray(stream, tokens.m_keywords);
+        stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+        if (!stream.flush()) {
+            stream.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary.c_str(), fileName.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool TokenCache::open(const std::string& fileName,
+                      uint64_t hash,
+                      size_t sourceLength)
+{
+    close();
+
+    if (!m_file.open(fileName) || m_file.size() < sizeof(Header)) {
+        close();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.sourceLength != sourceLength || header.hash != hash ||
+        header.tokens == 0 || header.tokens > UINT32_MAX ||
+        header.symbols > UINT32_MAX || header.namesLength > UINT32_MAX ||
+        m_file.size() !=
+            fileSize(header.tokens, header.symbols, header.namesLength)) {
+        close();
+        return false;
+    }
+
+    // Mappings are page aligned and every array starts on a multiple of its
+    // element size, so the arrays can be read in place.
+    size_t tokens = header.tokens;
+    auto words = reinterpret_cast<const uint32_t*>(m_file.data() +
+                                                   sizeof(Header));
+
+    m_offsets = words;
+    m_lengths = m_offsets + tokens;
+    m_symbols = m_lengths + tokens;
+    m_nameOffsets = m_symbols + tokens;
+
+    m_types = reinterpret_cast<const uint8_t*>(m_nameOffsets +
+                                               header.symbols + 1);
+    m_keywords = m_types + tokens;
+    m_names = reinterpret_cast<const char*>(m_keywords + tokens);
+
+    m_tokens = tokens;
+    m_symbolCount = header.symbols;
+
+    // The hash shows the source hasn't changed, not that the cache is intact.
+    // Check everything the tokenizer relies on, so a damaged cache is just a
+    // miss: tokens are in the source, and symbols and names are in range.
+    bool intact = m_types[tokens - 1] ==
+                  static_cast<uint8_t>(Token::Type::TEOF);
+
+    for (size_t i = 0; i < tokens; i++) {
+        intact &= m_types[i] <= static_cast<uint8_t>(Token::Type::TEOF);
+        intact &= m_keywords[i] < static_cast<uint8_t>(Keyword::COUNT);
+        intact &= static_cast<uint64_t>(m_offsets[i]) + m_lengths[i] <=
+                  sourceLength;
+        intact &= m_symbols[i] == SymbolTable::NONE ||
+                  m_symbols[i] < header.symbols;
+    }
+
+    intact &= m_nameOffsets[0] == 0 &&
+              m_nameOffsets[header.symbols] == header.namesLength;
+    for (size_t i = 0; i < header.symbols; i++) {
+        intact &= m_nameOffsets[i] <= m_nameOffsets[i + 1];
+    }
+
+    if (!intact) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void TokenCache::close()
+{
+    m_file.close();
+    m_tokens = 0;
+    m_symbolCount = 0;
+}
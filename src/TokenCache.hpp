@@ -0,0 +1,90 @@
+#ifndef TOKENCACHE_HPP
+#define TOKENCACHE_HPP
+
+#include "MappedFile.hpp"
+#include "Tokenizer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief TokenCache is a source file's token stream saved to a sidecar file,
+ * so an unchanged file can be parsed again without lexing it.
+ *
+ * The file starts with a header holding the length and {@code hash64} of the
+ * source it was made from, followed by one array per token field and then the
+ * spellings of the interned identifiers, in ID order. It's mapped rather than
+ * read, and tokens are served straight out of the mapping.
+ */
+class TokenCache
+{
+public:
+    TokenCache();
+
+    /**
+     * @brief write saves every token of a source to a cache file. The file is
+     * written under a temporary name and renamed into place, so readers never
+     * see a partial cache.
+     * @param tokens every token of the source, ending with EOF
+     * @return false if the file couldn't be written
+     */
+    static bool write(const std::string& fileName,
+                      uint64_t hash,
+                      size_t sourceLength,
+                      const TokenBuffer& tokens,
+                      const SymbolTable& symbols);
+
+    /**
+     * @brief open maps a cache file, if it was made from a source of the given
+     * length and hash and is intact.
+     * @return false if there's no such cache, in which case it's closed
+     */
+    bool open(const std::string& fileName, uint64_t hash, size_t sourceLength);
+
+    void close();
+
+    /**
+     * @brief size returns the number of tokens, including the final EOF.
+     */
+    size_t size() const
+    {
+        return m_tokens;
+    }
+
+    Token operator[](size_t index) const
+    {
+        return Token(static_cast<Token::Type>(m_types[index]),
+                     m_offsets[index], m_lengths[index],
+                     static_cast<Keyword>(m_keywords[index]),
+                     m_symbols[index]);
+    }
+
+    size_t symbolCount() const
+    {
+        return m_symbolCount;
+    }
+
+    std::string_view symbolName(size_t id) const
+    {
+        return std::string_view{m_names + m_nameOffsets[id],
+                                m_nameOffsets[id + 1] - m_nameOffsets[id]};
+    }
+
+private:
+    MappedFile m_file;
+
+    size_t m_tokens;
+    size_t m_symbolCount;
+
+    // Views of the arrays in the mapping.
+    const uint32_t* m_offsets;
+    const uint32_t* m_lengths;
+    const uint32_t* m_symbols;
+    const uint8_t* m_types;
+    const uint8_t* m_keywords;
+    const uint32_t* m_nameOffsets;
+    const char* m_names;
+};
+
+#endif // TOKENCACHE_HPP
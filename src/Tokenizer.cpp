@@ -1,37 +1,37 @@
 #include "Tokenizer.hpp"
 
+#include "CharClass.hpp"
+#include "ChunkReader.hpp"
+#include "Hash.hpp"
+#include "Scan.hpp"
+#include "TokenCache.hpp"
+
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <limits>
 
-// Create a mapping for human readable names.
-std::map<Token::Type, std::string> Token::TYPE_NAMES{
-    std::make_pair(Token::Type::IDENTIFIER, "IDENTIFIER"),
-    std::make_pair(Token::Type::INTEGER, "INTEGER"),
-    std::make_pair(Token::Type::KEYWORD, "KEYWORD"),
-    std::make_pair(Token::Type::WHITESPACE, "WHITESPACE"),
-    std::make_pair(Token::Type::LPAREN, "LPAREN"),
-    std::make_pair(Token::Type::RPAREN, "RPAREN"),
-    std::make_pair(Token::Type::SYMBOL, "SYMBOL"),
-    std::make_pair(Token::Type::INTEGER, "INTEGER"),
-    std::make_pair(Token::Type::OP, "OPERATION"),
-    std::make_pair(Token::Type::ASSIGNMENT, "ASSIGNMENT"),
-    std::make_pair(Token::Type::TEOF, "EOF"),
-    std::make_pair(Token::Type::UNKNOWN, "UNRECOGNIZED TOKEN"),
-};
-
-// A list of symbols
-std::vector<std::string> Tokenizer::SYMBOLS{",", ";"};
-
-// A list of keywords
-std::vector<std::string> Tokenizer::KEYWORDS{"BEGIN", "END", "READ", "WRITE"};
+namespace
+{
+// Tokens copied out of a cache at a time.
+const size_t CACHE_BATCH = 256;
+} // namespace
 
 Tokenizer::Tokenizer()
-    : m_lineNumber{1}
-    , m_columNumber{1}
+    : m_data{""}
+    , m_length{0}
+    , m_stream{nullptr}
     , m_index{0}
+    , m_cursor{0}
+    , m_cacheIndex{0}
+    , m_tokenCounts{}
+    , m_exhausted{true}
+    , m_lineIndex{&m_lines}
+    , m_windowStart{1, 1}
 {}
 
+Tokenizer::~Tokenizer() = default;
+
 bool Tokenizer::loadFile(const std::string& fileName)
 {
     // Open the file stream to read from.
@@ -45,375 +45,395 @@ bool Tokenizer::loadFile(const std::string& fileName)
     std::string contents{std::istreambuf_iterator<char>(fileStream),
                          std::istreambuf_iterator<char>()};
 
-    m_source = contents;
-    m_index = 0;
-    m_lineNumber = 1;
-    m_columNumber = 1;
+    return loadSource(std::move(contents));
+}
 
-    // Load all of the tokens into the queue.
+bool Tokenizer::loadSource(std::string source)
+{
+    // Token offsets are 32 bits wide.
+    if (source.length() > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    m_file.close();
+    m_source = std::move(source);
+    reset(m_source.data(), m_source.length());
+
+    // Load all of the tokens into the buffer.
     loadTokens();
 
     return true;
 }
 
-Token Tokenizer::nextToken()
+bool Tokenizer::mapFile(const std::string& fileName)
 {
-    // Retrieve and remove the front token.
-    Token token = m_tokens.front();
-    m_tokens.pop();
+    // Map the file, the tokens will be read from it as they're requested.
+    if (!m_file.open(fileName)) {
+        return false;
+    }
 
-    return token;
+    // Token offsets are 32 bits wide.
+    if (m_file.size() > std::numeric_limits<uint32_t>::max()) {
+        m_file.close();
+        return false;
+    }
+
+    m_source.clear();
+    reset(m_file.data(), m_file.size());
+
+    return true;
 }
 
-Token Tokenizer::peekToken()
+void Tokenizer::viewSource(const char* data,
+                           size_t begin,
+                           size_t end,
+                           const LineIndex* lines)
 {
-    // Retrieve the front token, but don't remove it.
-    return m_tokens.front();
+    m_file.close();
+    m_source.clear();
+    reset(data, end);
+
+    m_index = begin;
+    if (lines != nullptr) {
+        m_lineIndex = lines;
+    }
 }
 
-Token Tokenizer::readNextToken()
+void Tokenizer::streamFrom(ChunkReader& reader)
 {
-    // If the index is passed the end of the source code, return EOF.
-    if (m_index >= m_source.length()) {
-        return Token(Token::Type::TEOF, "", m_lineNumber, m_columNumber);
-    }
+    m_file.close();
+    m_source.clear();
+    reset(m_source.data(), 0);
 
-    Token token;
+    m_stream = &reader;
+    m_lineIndex = nullptr;
+}
 
-    // Attempt to read whitespace
-    push();
-    if (readWhitespace(token)) {
-        return token;
-    } else {
-        pop();
-    }
+void Tokenizer::reset(const char* data, size_t length)
+{
+    m_data = data;
+    m_length = length;
+    m_stream = nullptr;
+    m_index = 0;
+    m_exhausted = false;
 
-    // Attempt to read an identifier
-    push();
-    if (readIdentifier(token)) {
-        // Check if the identifier is a reserved keyword, if so change the token
-        // type.
-        if (std::find(std::begin(KEYWORDS), std::end(KEYWORDS), token.data) !=
-            std::end(KEYWORDS)) {
-            token.type = Token::Type::KEYWORD;
-        }
+    m_lines.reset(data, length);
+    m_lineIndex = &m_lines;
+    m_windowStart = SourcePosition{1, 1};
 
-        return token;
-    } else {
-        pop();
-    }
+    m_tokens.clear();
+    m_cursor = 0;
+    m_cache.reset();
+    m_symbols.clear();
+    m_tokenCounts.fill(0);
+}
 
-    // Attempt to read a symbol
-    push();
-    if (readSymbol(token)) {
-        return token;
-    } else {
-        pop();
-    }
+bool Tokenizer::useTokenCache(const std::string& cacheFile)
+{
+    uint64_t hash = hash64(m_data, m_length);
 
-    // Attempt to read an integer
-    push();
-    if (readInteger(token)) {
-        return token;
-    } else {
-        pop();
-    }
+    auto cache = std::make_unique<TokenCache>();
 
-    // Attempt to read a left or right parenthesis.
-    push();
-    if (readParens(token)) {
-        return token;
-    } else {
-        pop();
-    }
+    if (cache->open(cacheFile, hash, m_length)) {
+        // Interning the names in order gives them the IDs the tokens use.
+        m_symbols.clear();
+        for (size_t i = 0; i < cache->symbolCount(); i++) {
+            std::string_view name = cache->symbolName(i);
+            m_symbols.intern(name.data(), name.length());
+        }
 
-    // Attempt to read the assignment operator.
-    push();
-    if (readAssignment(token)) {
-        return token;
-    } else {
-        pop();
+        m_tokens.clear();
+        m_cursor = 0;
+        m_tokenCounts.fill(0);
+        m_cache = std::move(cache);
+        m_cacheIndex = 0;
+        m_exhausted = false;
+        return true;
     }
 
-    // Attempt to read an operation (+/-)
-    push();
-    if (readOp(token)) {
-        return token;
-    } else {
-        pop();
+    // The cache needs every token, so lex the rest of the source now.
+    if (!m_exhausted) {
+        loadTokens();
     }
 
-    token = Token(Token::Type::UNKNOWN, "", m_lineNumber, m_columNumber);
+    TokenCache::write(cacheFile, hash, m_length, m_tokens, m_symbols);
+    return false;
+}
 
-    // Make index out of range to stop parsing tokens.
-    m_index = std::numeric_limits<size_t>::max();
+Token Tokenizer::nextToken()
+{
+    fillLookahead();
 
-    return token;
+    // Retrieve and consume the front token.
+    return m_tokens[m_cursor++];
 }
 
-bool Tokenizer::readWhitespace(Token& outputToken)
+Token Tokenizer::peekToken()
 {
-    std::string data;
+    fillLookahead();
 
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
+    // Retrieve the front token, but don't consume it.
+    return m_tokens[m_cursor];
+}
 
-    // While the next character is whitespace, add it to the token data.
-    while (::iswspace(peek())) {
-        data += next();
+Token Tokenizer::readNextToken()
+{
+    // Streamed input is read until the next token is whole, or the stream
+    // has ended.
+    while (m_stream != nullptr && !tokenComplete()) {
+        refill();
     }
 
-    // Construct the token
-    if (!data.empty()) {
-        outputToken.type = Token::Type::WHITESPACE;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+    // If the index is passed the end of the source code, return EOF.
+    if (m_index >= m_length) {
+        m_exhausted = true;
+        return Token(Token::Type::TEOF, m_length, 0);
     }
 
-    return !data.empty();
-}
+    size_t start = m_index;
 
-bool Tokenizer::readIdentifier(Token& outputToken)
-{
-    std::string data;
+    Token::Type type;
 
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
+    switch (classify(m_data[m_index])) {
+    case CharClass::WHITESPACE:
+        skipWhitespace();
+        type = Token::Type::WHITESPACE;
+        break;
 
-    // Make sure the first character is a letter
-    if (::isalpha(peek())) {
-        data += next();
+    case CharClass::LETTER: {
+        // Identifiers continue with letters, digits, or underscores.
+        const char* end =
+            scan::skipIdentifierTail(m_data + start + 1, m_data + m_length);
+        skip(end - (m_data + start));
 
-        // Read while it's a letter, numeric, or underscore.
-        while (::isalnum(peek()) || peek() == '_') {
-            data += next();
-        }
-    }
+        // Check if the identifier is a reserved keyword.
+        size_t length = m_index - start;
+        Keyword keyword = classifyKeyword(m_data + start, length);
 
-    // Construct the token
-    if (!data.empty()) {
-        // Convert the name to uppercase so we dont' have to worry about casing.
-        for (auto& c : data) {
-            c = ::toupper(c);
+        if (keyword != Keyword::NONE) {
+            return Token(Token::Type::KEYWORD, start, length, keyword);
         }
 
-        outputToken.type = Token::Type::IDENTIFIER;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+        return Token(Token::Type::IDENTIFIER, start, length, keyword,
+                     m_symbols.intern(m_data + start, length));
     }
 
-    return !data.empty();
-}
-
-bool Tokenizer::readSymbol(Token& outputToken)
-{
-    std::string data;
-
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
-
-    // Determine if the next character is in the list of symbols.
-    for (auto symbol : Tokenizer::SYMBOLS) {
-        for (int i = 0; i < symbol.length(); i++) {
-            if (peek() == symbol[i]) {
-                data += next();
-            }
-        }
+    case CharClass::DIGIT: {
+        const char* end =
+            scan::skipDigits(m_data + start + 1, m_data + m_length);
+        skip(end - (m_data + start));
+        type = Token::Type::INTEGER;
+        break;
     }
 
-    // Construct the token
-    if (!data.empty()) {
-        outputToken.type = Token::Type::SYMBOL;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+    case CharClass::SYMBOL:
+        skip(1);
+        type = Token::Type::SYMBOL;
+        break;
+
+    case CharClass::LPAREN:
+        skip(1);
+        type = Token::Type::LPAREN;
+        break;
+
+    case CharClass::RPAREN:
+        skip(1);
+        type = Token::Type::RPAREN;
+        break;
+
+    case CharClass::OP:
+        skip(1);
+        type = Token::Type::OP;
+        break;
+
+    case CharClass::COLON:
+        // The assignment operator requires both : and = without any
+        // whitespace.
+        if (m_index + 1 < m_length && m_data[m_index + 1] == '=') {
+            skip(2);
+            type = Token::Type::ASSIGNMENT;
+            break;
+        }
+        // A lone colon isn't a token.
+        skip(1);
+        type = Token::Type::UNKNOWN;
+        break;
+
+    default:
+        // Unrecognized characters become single character tokens, leaving it
+        // to the parser to report them and carry on after them.
+        skip(1);
+        type = Token::Type::UNKNOWN;
+        break;
     }
 
-    return !data.empty();
+    return Token(type, start, m_index - start);
 }
 
-bool Tokenizer::readInteger(Token& outputToken)
+bool Tokenizer::tokenComplete() const
 {
-    std::string data;
-
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
+    const char* begin = m_data + m_index;
+    const char* end = m_data + m_length;
 
-    // While what we're reading is a digit, add it to the data.
-    while (::isdigit(peek())) {
-        data += next();
+    if (begin == end) {
+        return false;
     }
 
-    // Construct the token.
-    if (!data.empty()) {
-        outputToken.type = Token::Type::INTEGER;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+    switch (classify(*begin)) {
+    case CharClass::LETTER:
+        return scan::skipIdentifierTail(begin + 1, end) != end;
+    case CharClass::DIGIT:
+        return scan::skipDigits(begin + 1, end) != end;
+    case CharClass::COLON:
+        // Could be the start of :=
+        return begin + 1 != end;
+    default:
+        return true;
     }
-
-    return !data.empty();
 }
 
-bool Tokenizer::readParens(Token& outputToken)
+void Tokenizer::refill()
 {
-    std::string data;
-
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
-
-    // Check for left paranthesis, if found add the token.
-    if (peek() == '(') {
-        data += next();
-        outputToken.type = Token::Type::LPAREN;
-    } else if (peek() == ')') {
-        // Additionally check for the right paranthesis.
-        data += next();
-        outputToken.type = Token::Type::RPAREN;
-    }
+    // Nothing before the index is needed: every token read has been consumed
+    // before another is read. Only where it leaves off is kept.
+    m_windowStart =
+        LineIndex::advance(m_windowStart, m_data, m_data + m_index);
+    m_source.erase(0, m_index);
+    m_index = 0;
 
-    if (!data.empty()) {
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+    if (!m_stream->next(m_source)) {
+        m_stream = nullptr;
     }
 
-    return !data.empty();
+    m_data = m_source.data();
+    m_length = m_source.length();
 }
 
-bool Tokenizer::readAssignment(Token& outputToken)
+SourcePosition Tokenizer::position(uint32_t offset) const
 {
-    std::string data;
-
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
-
-    // Check for the assignment operator. This requires both : and = without any
-    // whitespace.
-    if (peek() == ':') {
-        data += next();
-
-        if (peek() == '=') {
-            data += next();
-        }
-    }
-
-    // Construct the token.
-    if (data == ":=") {
-        outputToken.type = Token::Type::ASSIGNMENT;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
+    if (m_lineIndex != nullptr) {
+        return m_lineIndex->position(offset);
     }
 
-    return !data.empty();
+    return LineIndex::advance(m_windowStart, m_data, m_data + offset);
 }
 
-bool Tokenizer::readOp(Token& outputToken)
+void Tokenizer::skipWhitespace()
 {
-    std::string data;
-
-    size_t startLine = m_lineNumber;
-    size_t startColumn = m_columNumber;
-
-    // Attempt to read an operator.
-    if (peek() == '+') {
-        data += next();
-    } else if (peek() == '-') {
-        data += next();
-    }
-
-    // Construct the token
-    if (!data.empty()) {
-        outputToken.type = Token::Type::OP;
-        outputToken.data = data;
-        outputToken.lineNumber = startLine;
-        outputToken.columnNumber = startColumn;
-    }
-
-    return !data.empty();
+    m_index = scan::skipWhitespace(m_data + m_index, m_data + m_length) - m_data;
 }
 
 void Tokenizer::loadTokens()
 {
     Token token;
 
+    // Guess at the token count up front to avoid regrowing the buffer.
+    m_tokens.reserve(m_length / 4);
+
     // Read al tokens until EOF is found.
     do {
         token = readNextToken();
 
-        // Don't add whitespace to the queue of tokens.
+        // Don't add whitespace to the buffer of tokens.
         if (token.type != Token::Type::WHITESPACE) {
             m_tokens.push(token);
         }
+
+        if (token.type != Token::Type::WHITESPACE &&
+            token.type != Token::Type::TEOF) {
+            m_tokenCounts[static_cast<size_t>(token.type)]++;
+        }
     } while (token.type != Token::Type::TEOF);
 }
 
-char Tokenizer::next()
+void Tokenizer::fillLookahead()
 {
-    // If the index is out of range, return EOF.
-    if (m_source.length() <= m_index) {
-        return EOF;
-    } else {
-        char read = m_source[m_index++];
-
-        if (read == '\r') {
-            // Technically, carriage return means to reset column number, so
-            // handle that here.
-            m_columNumber = 0;
-        } else if (read == '\n') {
-            // Reset the column numner and line number with \n
-            // Since on windows it sends \r\n but on linux it's only \n
-            m_columNumber = 0;
-            m_lineNumber++;
+    if (m_cursor < m_tokens.size()) {
+        return;
+    }
+
+    // Everything buffered has been consumed, so the buffer can be reused.
+    m_tokens.clear();
+    m_cursor = 0;
+
+    Token token;
+
+    // Cached tokens only need copying out, so take a batch at a time. The
+    // last is EOF, which is handed out again for as long as it's asked for.
+    if (m_cache) {
+        size_t end = std::min(m_cacheIndex + CACHE_BATCH, m_cache->size());
+
+        for (; m_cacheIndex < end; m_cacheIndex++) {
+            token = (*m_cache)[m_cacheIndex];
+            m_tokens.push(token);
+
+            if (token.type != Token::Type::TEOF) {
+                m_tokenCounts[static_cast<size_t>(token.type)]++;
+            }
         }
 
-        // Regardless, column number needs incremented.
-        m_columNumber++;
+        if (m_cacheIndex == m_cache->size()) {
+            m_cacheIndex--;
+            m_exhausted = true;
+        }
 
-        return read;
+        return;
     }
-}
 
-char Tokenizer::peek()
-{
-    // Check for EOF, and return the current char
-    if (m_source.length() <= m_index) {
-        return EOF;
-    } else {
-        return m_source[m_index];
+    // Skip over whitespace until a real token is found. Once the source is
+    // exhausted this keeps producing EOF tokens.
+    do {
+        token = readNextToken();
+    } while (token.type == Token::Type::WHITESPACE);
+
+    m_tokens.push(token);
+
+    if (token.type != Token::Type::TEOF) {
+        m_tokenCounts[static_cast<size_t>(token.type)]++;
     }
 }
 
-void Tokenizer::push()
+Token::Token(Token::Type type,
+             uint32_t offset,
+             uint32_t length,
+             Keyword keyword,
+             uint32_t symbol)
+    : type{type}
+    , keyword{keyword}
+    , offset{offset}
+    , length{length}
+    , symbol{symbol}
+{}
+
+void TokenBuffer::push(const Token& token)
 {
-    // Push the current state of the tokenizer.
-    TokenizerState state;
-    state.columnNumber = m_columNumber;
-    state.lineNumber = m_lineNumber;
-    state.index = m_index;
+    m_types.push_back(token.type);
+    m_keywords.push_back(token.keyword);
+    m_offsets.push_back(token.offset);
+    m_lengths.push_back(token.length);
+    m_symbols.push_back(token.symbol);
+}
 
-    m_states.push(state);
+Token TokenBuffer::operator[](size_t index) const
+{
+    return Token(m_types[index], m_offsets[index], m_lengths[index],
+                 m_keywords[index], m_symbols[index]);
 }
 
-void Tokenizer::pop()
+void TokenBuffer::clear()
 {
-    // Reset the tokenizer to the last popped state.
-    if (!m_states.empty()) {
-        TokenizerState state = m_states.top();
-        m_states.pop();
-
-        m_columNumber = state.columnNumber;
-        m_lineNumber = state.lineNumber;
-        m_index = state.index;
-    }
+    m_types.clear();
+    m_keywords.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_symbols.clear();
 }
 
-Token::Token(Token::Type type, const std::string& data, size_t lineNumber, size_t columnNumber)
-    : type{type}
-    , data{data}
-    , lineNumber{lineNumber}
-    , columnNumber{columnNumber}
-{}
+void TokenBuffer::reserve(size_t count)
+{
+    m_types.reserve(count);
+    m_keywords.reserve(count);
+    m_offsets.reserve(count);
+    m_lengths.reserve(count);
+    m_symbols.reserve(count);
+}
@@ -1,22 +1,21 @@
 #ifndef TOKENIZER_HPP
 #define TOKENIZER_HPP
 
-#include <map>
-#include <queue>
-#include <stack>
+#include "Keywords.hpp"
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "SymbolTable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
-struct TokenizerState
-{
-    size_t index;
-    size_t lineNumber;
-    size_t columnNumber;
-};
-
 struct Token
 {
-    enum class Type
+    enum class Type : uint8_t
     {
         IDENTIFIER,
         KEYWORD,
@@ -31,33 +30,158 @@ struct Token
         TEOF,
     };
 
-    static std::map<Type, std::string> TYPE_NAMES;
+    /**
+     * @brief typeName returns the human readable name of a type. It's a
+     * constant table rather than a map, so nothing is built at startup.
+     */
+    static constexpr const char* typeName(Type type)
+    {
+        // In the order of Type.
+        constexpr const char* NAMES[] = {
+            "IDENTIFIER", "KEYWORD",    "INTEGER",
+            "WHITESPACE", "SYMBOL",     "LPAREN",
+            "RPAREN",     "OPERATION",  "ASSIGNMENT",
+            "UNRECOGNIZED TOKEN",       "EOF",
+        };
+
+        return NAMES[static_cast<size_t>(type)];
+    }
 
-    Token(Type type, const std::string& data, size_t lineNumber, size_t columnNumber);
+    Token(Type type,
+          uint32_t offset,
+          uint32_t length,
+          Keyword keyword = Keyword::NONE,
+          uint32_t symbol = SymbolTable::NONE);
     Token()
     {}
 
     Type type;
-    std::string data;
-    size_t lineNumber;
-    size_t columnNumber;
+
+    // Which keyword a KEYWORD token is, otherwise NONE.
+    Keyword keyword;
+
+    // The token's text is the range [offset, offset + length) of the source
+    // it was read from, see {@code Tokenizer::text}. Its line and column are
+    // only worked out when they're needed, see {@code Tokenizer::position}.
+    uint32_t offset;
+    uint32_t length;
+
+    // The interned ID of an IDENTIFIER token, otherwise SymbolTable::NONE.
+    uint32_t symbol;
 };
 
-class Tokenizer
+// How many tokens of each type were read, indexed by Token::Type.
+using TokenCounts =
+    std::array<uint64_t, static_cast<size_t>(Token::Type::TEOF) + 1>;
+
+/**
+ * @brief TokenBuffer stores tokens as a structure of arrays so a full token
+ * stream costs a handful of flat allocations rather than one per token.
+ */
+class TokenBuffer
 {
 public:
-    static std::vector<std::string> KEYWORDS;
-    static std::vector<std::string> SYMBOLS;
+    void push(const Token& token);
+
+    Token operator[](size_t index) const;
+
+    size_t size() const
+    {
+        return m_types.size();
+    }
+
+    bool empty() const
+    {
+        return m_types.empty();
+    }
+
+    void clear();
+    void reserve(size_t count);
+
+private:
+    friend class TokenCache;
+
+    std::vector<Token::Type> m_types;
+    std::vector<Keyword> m_keywords;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_lengths;
+    std::vector<uint32_t> m_symbols;
+};
+
+class ChunkReader;
+class TokenCache;
 
+class Tokenizer
+{
+public:
     Tokenizer();
+    ~Tokenizer();
 
     /**
      * @brief loadFile loads the contents of the specified file into the {@code CharBuffer}.
+     * Tokens address the source with 32-bit offsets, so files of 4 GiB or
+     * more are rejected.
      * @param fileName the file name to load
      * @return true if the file exists and was successfully loaded
      */
     bool loadFile(const std::string& fileName);
 
+    /**
+     * @brief mapFile memory maps the specified file and tokenizes it on demand.
+     * Unlike {@code loadFile}, no tokens are read up front; each call to
+     * {@code nextToken} or {@code peekToken} lexes just enough of the source
+     * to fill a single token of lookahead, so memory use doesn't grow with the
+     * size of the input. The same 4 GiB limit as {@code loadFile} applies.
+     * @param fileName the file name to map
+     * @return true if the file exists and was successfully mapped
+     */
+    bool mapFile(const std::string& fileName);
+
+    /**
+     * @brief viewSource tokenizes the range [begin, end) of a buffer owned by
+     * the caller, on demand like {@code mapFile}. Token offsets are from the
+     * start of the buffer, not of the range, so tokens read from part of a
+     * file are the same as if the whole file had been read. The buffer has
+     * to outlive the tokenizer's use of it.
+     * @param lines an index of the whole buffer to take positions from, so
+     * tokenizers of different parts of it can share one. Without it the
+     * tokenizer indexes [0, end) itself.
+     */
+    void viewSource(const char* data,
+                    size_t begin,
+                    size_t end,
+                    const LineIndex* lines = nullptr);
+
+    /**
+     * @brief streamFrom tokenizes input as a {@code ChunkReader} hands it
+     * over, on demand like {@code mapFile}. A token split between chunks is
+     * read once the rest of it arrives. Input is dropped as soon as it has
+     * been tokenized, so memory use doesn't grow with the length of the
+     * stream. Token offsets are into what's kept, so the text of a token is
+     * only available until the next token is read. The reader has to outlive
+     * the tokenizer's use of it.
+     */
+    void streamFrom(ChunkReader& reader);
+
+    /**
+     * @brief loadSource takes ownership of in-memory source code and loads all
+     * of its tokens, the same as {@code loadFile}.
+     * @param source the source code to tokenize
+     * @return true if the source is small enough to be tokenized
+     */
+    bool loadSource(std::string source);
+
+    /**
+     * @brief useTokenCache takes the tokens of the current source from a cache
+     * file made from the same contents, skipping lexing entirely. Otherwise
+     * every token is lexed now and the cache is written for next time. It has
+     * to be called before any token is read.
+     * @param cacheFile the cache file, usually the source's name with
+     * ".tokcache" added
+     * @return true if the tokens came from the cache
+     */
+    bool useTokenCache(const std::string& cacheFile);
+
     /**
      * @brief nextToken retrieves the next {@code Token} from the tokenizer and advances.
      * @return the next {@code Token}
@@ -76,17 +200,53 @@ public:
      */
     bool hasMoreTokens()
     {
-        return !m_tokens.empty();
+        return m_cursor < m_tokens.size() || !m_exhausted;
+    }
+
+    /**
+     * @brief text returns the source text of a token read from this tokenizer.
+     * The view is only valid while the source is loaded.
+     * @param token the token to retrieve the text of
+     * @return the text of the token
+     */
+    std::string_view text(const Token& token) const
+    {
+        return std::string_view{m_data + token.offset, token.length};
+    }
+
+    /**
+     * @brief position returns the line and column of a token's offset. The
+     * first call indexes the source, so it's meant for diagnostics rather
+     * than every token. While streaming, only offsets of the token just read
+     * can be looked up.
+     */
+    SourcePosition position(uint32_t offset) const;
+
+    /**
+     * @brief symbols returns the table of every identifier read so far. The
+     * {@code symbol} of an IDENTIFIER token is its ID in this table.
+     */
+    const SymbolTable& symbols() const
+    {
+        return m_symbols;
+    }
+
+    /**
+     * @brief length returns the length of the source being tokenized.
+     */
+    size_t length() const
+    {
+        return m_length;
     }
 
-protected:
-    bool readWhitespace(Token& outputToken);
-    bool readIdentifier(Token& outputToken);
-    bool readSymbol(Token& outputToken);
-    bool readInteger(Token& outputToken);
-    bool readParens(Token& outputToken);
-    bool readAssignment(Token& outputToken);
-    bool readOp(Token& outputToken);
+    /**
+     * @brief tokenCounts returns how many tokens of each type have been read
+     * from the current source, not counting whitespace or EOF.
+     */
+    const TokenCounts& tokenCounts() const
+    {
+        return m_tokenCounts;
+    }
 
 private:
     /**
@@ -95,50 +255,86 @@ private:
     void loadTokens();
 
     /**
-     * @brief next retrieves the next {@code Token} from the tokenizer.
+     * @brief fillLookahead reads the next non-whitespace token into the buffer
+     * if every buffered token has been consumed.
+     */
+    void fillLookahead();
+
+    /**
+     * @brief reset points the tokenizer at the start of a new source buffer.
+     */
+    void reset(const char* data, size_t length);
+
+    /**
+     * @brief readNextToken lexes the next {@code Token} from the source.
+     * The class of the first character decides the kind of token, and every
+     * character is examined once; nothing is ever read twice.
      * @return the next {@code Token}
      */
     Token readNextToken();
 
     /**
-     * @brief next read and return the next character in the source.
-     * If we are at the end of the source code, EOF is returned.
-     * The reading index is incremented.
-     *
-     * @return the next character read
+     * @brief skip advances over {@code count} characters.
      */
-    char next();
+    void skip(size_t count)
+    {
+        m_index += count;
+    }
 
     /**
-     * @brief peek read and return the next character in the source.
-     * If the next character is passed the end of the source code, EOF is
-     * returned. The reading index is NOT incremented.
-     *
-     * @return the next character read
+     * @brief skipWhitespace advances over a run of whitespace.
      */
-    char peek();
+    void skipWhitespace();
 
     /**
-     * @brief push stores the current source index on the stack.
+     * @brief tokenComplete returns whether the token at the current index
+     * ends before the end of the input read so far, so more input couldn't
+     * change it. Whitespace always counts as complete, since a run split in
+     * two is still skipped the same.
      */
-    void push();
+    bool tokenComplete() const;
 
     /**
-     * @brief pop returns the source to the last location of push.
-     * If no history exists, this is a no-op.
+     * @brief refill drops the input that has been tokenized and appends the
+     * next chunk of the stream, or stops streaming once it has ended.
      */
-    void pop();
+    void refill();
 
 private:
+    // Backing storage for the source; only one is in use at a time.
     std::string m_source;
+    MappedFile m_file;
+
+    // The source currently being tokenized.
+    const char* m_data;
+    size_t m_length;
+
+    // Where more input comes from when streaming, otherwise null. The input
+    // read so far is kept in m_source.
+    ChunkReader* m_stream;
 
     size_t m_index;
-    std::stack<TokenizerState> m_states;
 
-    std::queue<Token> m_tokens;
+    // Tokens read but not yet consumed start at m_cursor.
+    TokenBuffer m_tokens;
+    size_t m_cursor;
+
+    // When the tokens come from a cache, the next one to hand out.
+    std::unique_ptr<TokenCache> m_cache;
+    size_t m_cacheIndex;
+
+    SymbolTable m_symbols;
+    TokenCounts m_tokenCounts;
+
+    // Set once the EOF token has been read from the source.
+    bool m_exhausted;
 
-    unsigned int m_lineNumber;
-    unsigned int m_columNumber;
+    // Where positions come from: m_lines, an index shared by the caller, or
+    // null while streaming. Streamed input that has been dropped is only
+    // kept as the position of what's left, m_windowStart.
+    LineIndex m_lines;
+    const LineIndex* m_lineIndex;
+    SourcePosition m_windowStart;
 
     static Token EOFToken;
 };
@@ -0,0 +1,171 @@
+#include "Vm.hpp"
+
+#include <charconv>
+
+namespace
+{
+// Flush the output once this much has been gathered.
+const size_t BUFFER_SIZE = 64 * 1024;
+
+// Arithmetic is done unsigned so that overflow wraps rather than being
+// undefined.
+inline int64_t add(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) +
+                                static_cast<uint64_t>(b));
+}
+
+inline int64_t subtract(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) -
+                                static_cast<uint64_t>(b));
+}
+} // namespace
+
+// Dispatch with computed goto where the compiler supports it: every handler
+// jumps straight to the next one through a table of label addresses, which
+// gives each handler its own indirect branch to predict. Elsewhere it's a
+// switch in a loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+RuntimeIo::RuntimeIo(std::istream& input, std::ostream& output)
+    : m_input{input}
+    , m_output{output}
+{}
+
+Vm::Vm(std::istream& input, std::ostream& output)
+    : m_io{input, output}
+{}
+
+bool Vm::run(const Bytecode& bytecode)
+{
+    m_error.clear();
+    m_registers.assign(bytecode.registers(), 0);
+
+    const Instruction* ip = bytecode.code().data();
+    const int64_t* constants = bytecode.constants().data();
+    int64_t* r = m_registers.data();
+
+    bool ok = true;
+
+#if VM_COMPUTED_GOTO
+    // In the same order as Opcode.
+    static void* const LABELS[] = {&&LOADK, &&MOVE,  &&ADD,   &&SUB, &&ADDK,
+                                   &&SUBK,  &&READ,  &&WRITE, &&HALT};
+
+#define DISPATCH() goto* LABELS[static_cast<int>(ip->opcode)]
+#define CASE(name) name:
+#define NEXT()                                                                 \
+    ip++;                                                                      \
+    DISPATCH()
+
+    DISPATCH();
+#else
+#define CASE(name) case Opcode::name:
+#define NEXT()                                                                 \
+    ip++;                                                                      \
+    continue
+
+    while (true) {
+        switch (ip->opcode) {
+#endif
+
+    CASE(LOADK)
+    {
+        r[ip->a] = constants[ip->b];
+        NEXT();
+    }
+    CASE(MOVE)
+    {
+        r[ip->a] = r[ip->b];
+        NEXT();
+    }
+    CASE(ADD)
+    {
+        r[ip->a] = add(r[ip->b], r[ip->c]);
+        NEXT();
+    }
+    CASE(SUB)
+    {
+        r[ip->a] = subtract(r[ip->b], r[ip->c]);
+        NEXT();
+    }
+    CASE(ADDK)
+    {
+        r[ip->a] = add(r[ip->b], constants[ip->c]);
+        NEXT();
+    }
+    CASE(SUBK)
+    {
+        r[ip->a] = subtract(r[ip->b], constants[ip->c]);
+        NEXT();
+    }
+    CASE(READ)
+    {
+        if (!m_io.read(r[ip->a])) {
+            m_error = "Unable to read a value for " + bytecode.name(ip->a) + ".";
+            ok = false;
+            goto done;
+        }
+        NEXT();
+    }
+    CASE(WRITE)
+    {
+        m_io.write(r + ip->a, ip->b);
+        NEXT();
+    }
+    CASE(HALT)
+    {
+        goto done;
+    }
+
+#if !VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+
+done:
+    m_io.flush();
+    return ok;
+}
+
+bool RuntimeIo::read(int64_t& value)
+{
+    // Anything already written should be seen before waiting for input.
+    flush();
+
+    return static_cast<bool>(m_input >> value);
+}
+
+void RuntimeIo::write(const int64_t* values, uint32_t count)
+{
+    char digits[24];
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i != 0) {
+            m_buffer += ' ';
+        }
+
+        auto result = std::to_chars(digits, digits + sizeof(digits), values[i]);
+        m_buffer.append(digits, result.ptr);
+    }
+    m_buffer += '\n';
+
+    if (m_buffer.length() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void RuntimeIo::flush()
+{
+    m_output.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+}
@@ -0,0 +1,79 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include "Bytecode.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief RuntimeIo is the input and output of running programs. READ takes
+ * the next whitespace separated integer from the input, and WRITE prints its
+ * values separated by spaces, one WRITE per line. Output is gathered and
+ * written out in large pieces.
+ */
+class RuntimeIo
+{
+public:
+    RuntimeIo(std::istream& input, std::ostream& output);
+
+    /**
+     * @brief read reads the next integer from the input. Anything written so
+     * far is flushed first.
+     * @return false if there isn't one
+     */
+    bool read(int64_t& value);
+
+    void write(const int64_t* values, uint32_t count);
+
+    void flush();
+
+private:
+    std::istream& m_input;
+    std::ostream& m_output;
+
+    std::string m_buffer;
+};
+
+/**
+ * @brief Vm runs {@code Bytecode}, with {@code RuntimeIo} doing READ and
+ * WRITE. Every variable starts at zero.
+ */
+class Vm
+{
+public:
+    Vm(std::istream& input, std::ostream& output);
+
+    /**
+     * @brief run executes a program from the start.
+     * @return false if the program stopped early, see {@code error}
+     */
+    bool run(const Bytecode& bytecode);
+
+    /**
+     * @brief error describes why the last run stopped early.
+     */
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+    /**
+     * @brief registers returns the registers as the last run left them.
+     */
+    const std::vector<int64_t>& registers() const
+    {
+        return m_registers;
+    }
+
+private:
+    RuntimeIo m_io;
+
+    std::vector<int64_t> m_registers;
+    std::string m_error;
+};
+
+#endif // VM_HPP
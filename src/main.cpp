@@ -1,48 +1,543 @@
-#include "Parser.hpp"
-#include "Tokenizer.hpp"
+#include "BatchVm.hpp"
+#include "Driver.hpp"
+#include "Jit.hpp"
+#include "ResultCache.hpp"
+#include "Server.hpp"
+#include "Vm.hpp"
 
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+namespace
+{
+/**
+ * @brief printCompiled prints what was asked for of a file that compiled.
+ */
+void printCompiled(const std::string& fileName,
+                   const CompileResult& result,
+                   const CompileOptions& options)
+{
+    // Any warnings come first.
+    for (const Diagnostic& diagnostic : result.diagnostics) {
+        std::cout << diagnostic << std::endl;
+    }
+
+    std::cout << "Successfully compiled " << fileName << "." << std::endl;
+
+    if (options.optimizerStats) {
+        std::cout << result.optimizerStats;
+    }
+
+    std::cout << result.ast << result.ir;
+
+    if (options.dumpBytecode) {
+        result.bytecode.disassemble(std::cout);
+    }
+}
+
+/**
+ * @brief print prints the outcome of compiling a single file.
+ */
+void print(const std::string& fileName,
+           const CompileResult& result,
+           const CompileOptions& options)
+{
+    switch (result.status) {
+    case CompileResult::Status::COMPILED:
+        std::cout << "Successfully loaded file." << std::endl;
+        printCompiled(fileName, result, options);
+        break;
+    case CompileResult::Status::FAILED:
+        std::cout << "Successfully loaded file." << std::endl;
+        for (const Diagnostic& diagnostic : result.diagnostics) {
+            std::cout << diagnostic << std::endl;
+        }
+        break;
+    case CompileResult::Status::UNREADABLE:
+        std::cout << "Unable to load file." << std::endl;
+        break;
+    }
+}
+
+/**
+ * @brief usage prints the options, for when they can't be understood.
+ */
+void usage()
+{
+    std::cout
+        << "Usage: CompilerProject [options] [file | directory | @list | -]\n"
+           "  -O                  optimize\n"
+           "  --opt-stats         optimize and print what was removed\n"
+           "  --dump-ast          print the tree\n"
+           "  --dump-ir           print the IR\n"
+           "  --dump-bytecode     print the bytecode\n"
+           "  --warnings          warn of reads before assignment\n"
+           "  --run               run the program\n"
+           "  --jit               run the program as machine code\n"
+           "  --batch=FILE        run the program over every row of FILE\n"
+           "  --batch-output=FILE where --batch writes its results\n"
+           "  --jobs N            compile on N threads\n"
+           "  --parallel          parse each file on several threads\n"
+           "  --token-cache       keep tokens next to each file\n"
+           "  --cache=DIR         keep results in DIR\n"
+           "  --cache-limit=N[K|M|G]  trim the result cache to N bytes\n"
+           "  --stats             print how long each phase took\n"
+           "  --trace=FILE        write a trace of the phases to FILE\n"
+           "  --serve=SOCKET      compile for clients on SOCKET\n"
+           "  --connect=SOCKET    have a server on SOCKET compile\n"
+           "  --stop              stop the server after compiling\n";
+}
+
+/**
+ * @brief parseNumber reads a whole number, all of the text.
+ * @return false if the text isn't one
+ */
+bool parseNumber(const std::string& text, uint64_t& value)
+{
+    const char* end = text.data() + text.length();
+    auto result = std::from_chars(text.data(), end, value);
+
+    return result.ec == std::errc{} && result.ptr == end;
+}
+
+/**
+ * @brief parseSize reads a size in bytes, with an optional K, M or G suffix.
+ * @return false if the text isn't one, or the size doesn't fit
+ */
+bool parseSize(const std::string& text, uint64_t& size)
+{
+    const char* end = text.data() + text.length();
+    auto result = std::from_chars(text.data(), end, size);
+
+    if (result.ec != std::errc{} || result.ptr == text.data()) {
+        return false;
+    }
+
+    if (result.ptr == end) {
+        return true;
+    }
+
+    // A single suffix may follow.
+    if (result.ptr + 1 != end) {
+        return false;
+    }
+
+    unsigned shift;
+
+    switch (*result.ptr) {
+    case 'K':
+        shift = 10;
+        break;
+    case 'M':
+        shift = 20;
+        break;
+    case 'G':
+        shift = 30;
+        break;
+    default:
+        return false;
+    }
+
+    if (size > (UINT64_MAX >> shift)) {
+        return false;
+    }
+
+    size <<= shift;
+    return true;
+}
+
+/**
+ * @brief execute runs a compiled program, as machine code if asked to and it
+ * can be generated here, otherwise on the VM.
+ * @return false if the program stopped early
+ */
+bool execute(const Bytecode& bytecode, bool jit)
+{
+    if (jit && Jit::supported()) {
+        Jit compiled{std::cin, std::cout};
+
+        if (!compiled.compile(bytecode) || !compiled.run()) {
+            std::cout << compiled.error() << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    Vm vm{std::cin, std::cout};
+
+    if (!vm.run(bytecode)) {
+        std::cout << vm.error() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief executeBatch runs a compiled program once for every row of a column
+ * file, writing what it writes to another.
+ * @return false if the program couldn't be run over the input
+ */
+bool executeBatch(const Bytecode& bytecode,
+                  const std::string& inputFile,
+                  const std::string& outputFile)
+{
+    ColumnFile input;
+    if (!input.open(inputFile)) {
+        std::cout << "Unable to read columns from " << inputFile << "."
+                  << std::endl;
+        return false;
+    }
+
+    ColumnWriter output;
+    uint32_t columns = BatchVm::outputColumns(bytecode);
+
+    if (!output.open(outputFile, columns, input.rows())) {
+        std::cout << "Unable to write " << outputFile << "." << std::endl;
+        return false;
+    }
+
+    BatchVm vm;
+    bool ran = vm.run(bytecode, input,
+                      [&](uint32_t column, uint64_t row,
+                          const int64_t* values, size_t count) {
+                          output.write(column, row, values, count);
+                      });
+
+    if (!ran) {
+        std::cout << vm.error() << std::endl;
+        return false;
+    }
+
+    if (!output.close()) {
+        std::cout << "Unable to write " << outputFile << "." << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote " << input.rows() << " rows of " << columns
+              << " columns to " << outputFile << "." << std::endl;
+    return true;
+}
+
+/**
+ * @brief serve compiles files for clients until one asks the server to stop.
+ */
+bool serve(const std::string& socketPath,
+           const CompileOptions& options,
+           unsigned jobs)
+{
+    Server server{options, jobs};
+
+    if (!server.listen(socketPath)) {
+        std::cout << server.error() << std::endl;
+        return false;
+    }
+
+    std::cout << "Listening on " << socketPath << "." << std::endl;
+    server.serve();
+
+    if (!options.resultCache.empty()) {
+        ResultCache{options.resultCache}.trim(options.resultCacheLimit);
+    }
+
+    return true;
+}
+
+/**
+ * @brief connect has a server compile every file, printing each result as if
+ * the file had been compiled here. An input of "-" is source read from the
+ * standard input. A single file is run if asked.
+ * @return the exit status
+ */
+int connect(const std::string& socketPath,
+            const std::vector<std::string>& inputs,
+            const CompileOptions& options,
+            bool run,
+            bool jit,
+            bool stop)
+{
+    Client client;
+
+    if (!client.connect(socketPath)) {
+        std::cout << client.error() << std::endl;
+        return 1;
+    }
+
+    // Directories and lists are expanded here, as the server only takes files.
+    Driver files{options};
+    for (const std::string& input : inputs) {
+        if (!files.addInput(input)) {
+            std::cout << "Unable to read " << input << "." << std::endl;
+            return 1;
+        }
+    }
+
+    int status = 0;
+
+    for (const std::string& fileName : files.files()) {
+        CompileResult result;
+        bool answered;
+
+        if (fileName == "-") {
+            std::string source{std::istreambuf_iterator<char>(std::cin),
+                               std::istreambuf_iterator<char>()};
+            answered = client.compileSource(source, options, result);
+        } else {
+            answered = client.compileFile(fileName, options, result);
+        }
+
+        if (!answered) {
+            std::cout << client.error() << std::endl;
+            return 1;
+        }
+
+        print(fileName, result, options);
+
+        if (result.status != CompileResult::Status::COMPILED) {
+            status = 1;
+        } else if (run && files.files().size() == 1 &&
+                   !execute(result.bytecode, jit)) {
+            status = 1;
+        }
+    }
+
+    if (stop && !client.stop()) {
+        std::cout << client.error() << std::endl;
+        return 1;
+    }
+
+    return status;
+}
+} // namespace
+
 int main(int argc, char** argv)
 {
-    std::string fileName;
+    std::vector<std::string> inputs;
+    CompileOptions options;
+    unsigned jobs = 0;
+    bool run = false;
+    bool jit = false;
+    bool printStats = false;
+    std::string traceFile;
+    std::string serveSocket;
+    std::string connectSocket;
+    bool stopServer = false;
+    std::string batchInput;
+    std::string batchOutput;
+
+    // Options start with --, anything else is a file, directory or @list to
+    // compile. A file whose name starts with -- can be given as ./--name.
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        if (argument == "--dump-ast") {
+            options.dumpAst = true;
+        } else if (argument == "-O") {
+            options.optimize = true;
+        } else if (argument == "--opt-stats") {
+            options.optimize = true;
+            options.optimizerStats = true;
+        } else if (argument == "--dump-ir") {
+            options.dumpIr = true;
+        } else if (argument == "--dump-bytecode") {
+            options.dumpBytecode = true;
+        } else if (argument == "--warnings") {
+            options.warnings = true;
+        } else if (argument == "--run") {
+            options.bytecode = true;
+            run = true;
+        } else if (argument == "--jit") {
+            options.bytecode = true;
+            run = true;
+            jit = true;
+        } else if (argument.rfind("--batch=", 0) == 0) {
+            options.bytecode = true;
+            batchInput = argument.substr(8);
+        } else if (argument.rfind("--batch-output=", 0) == 0) {
+            batchOutput = argument.substr(15);
+        } else if (argument == "--jobs") {
+            uint64_t count;
+            if (i + 1 == argc) {
+                std::cout << "--jobs needs a number." << std::endl;
+                usage();
+                return 1;
+            }
+            if (!parseNumber(argv[++i], count) || count > UINT_MAX) {
+                std::cout << "--jobs needs a number, not " << argv[i] << "."
+                          << std::endl;
+                usage();
+                return 1;
+            }
+            jobs = static_cast<unsigned>(count);
+        } else if (argument == "--parallel") {
+            options.parallel = true;
+        } else if (argument == "--token-cache") {
+            options.tokenCache = true;
+        } else if (argument.rfind("--cache=", 0) == 0) {
+            options.resultCache = argument.substr(8);
+        } else if (argument.rfind("--cache-limit=", 0) == 0) {
+            if (!parseSize(argument.substr(14), options.resultCacheLimit)) {
+                std::cout << "--cache-limit= needs a size such as 64M, not "
+                          << argument.substr(14) << "." << std::endl;
+                usage();
+                return 1;
+            }
+        } else if (argument == "--stats") {
+            options.stats = true;
+            printStats = true;
+        } else if (argument.rfind("--trace=", 0) == 0) {
+            options.stats = true;
+            traceFile = argument.substr(8);
+        } else if (argument.rfind("--serve=", 0) == 0) {
+            serveSocket = argument.substr(8);
+        } else if (argument.rfind("--connect=", 0) == 0) {
+            connectSocket = argument.substr(10);
+        } else if (argument == "--stop") {
+            stopServer = true;
+        } else if (argument.rfind("--", 0) == 0) {
+            std::cout << "Unknown option " << argument << "." << std::endl;
+            usage();
+            return 1;
+        } else {
+            inputs.push_back(argument);
+        }
+    }
+
+    options.jobs = jobs;
+
+    if (!batchInput.empty() && batchOutput.empty()) {
+        std::cout << "--batch needs --batch-output=FILE for the results."
+                  << std::endl;
+        return 1;
+    }
+
+    if (!serveSocket.empty()) {
+        return serve(serveSocket, options, jobs) ? 0 : 1;
+    }
+
+    // Only stopping a server needs no files.
+    if (!connectSocket.empty() && (stopServer || !inputs.empty())) {
+        return connect(connectSocket, inputs, options, run, jit, stopServer);
+    }
 
     // Make sure if file argument isn't added, we prompt for one..
-    if (argc != 2) {
+    if (inputs.empty()) {
+        std::string fileName;
         std::cout << "Please enter the file name: ";
         std::getline(std::cin, fileName);
-    } else {
-      // File was supplied as an argument.
-      fileName = argv[1];
+        inputs.push_back(fileName);
     }
 
-    Tokenizer tokenizer;
+    if (!connectSocket.empty()) {
+        return connect(connectSocket, inputs, options, run, jit, stopServer);
+    }
+
+    // The standard input is compiled as it arrives, reporting errors as
+    // they're found.
+    if (inputs.size() == 1 && inputs[0] == "-") {
+        if (run || !batchInput.empty()) {
+            std::cout << "Programs read from the standard input can't be run."
+                      << std::endl;
+            return 1;
+        }
 
-    // Load the specified file.
-    if (tokenizer.loadFile(fileName)) {
         std::cout << "Successfully loaded file." << std::endl;
 
-        // Construct a parser for the tokenizer.
-        Parser parser{tokenizer};
+        CompileResult result = compileStream(
+            0, options, [](const Diagnostic& diagnostic) {
+                std::cout << diagnostic << std::endl;
+            });
 
-        // Attempt to parse the file, but if an exception is thrown, report the
-        // error to the user.
-        try {
-            parser.parse();
+        if (result.status == CompileResult::Status::COMPILED) {
+            Stats* stats = options.stats ? &result.stats : nullptr;
+            Stats::Timer timer{stats, Stats::Phase::FORMAT};
+            printCompiled(inputs[0], result, options);
+        }
 
-            // Compilation finished without throwing an exception.
-            std::cout << "Successfully compiled " << fileName << "." << std::endl;
-        } catch (ParserException& e) {
-            std::cout << "Expected " << e.expected() << ", but found "
-                      << e.actual() << " at " << e.lineNumber() << ":"
-                      << e.columnNumber() << std::endl;
+        if (printStats) {
+            result.stats.print(std::cout);
         }
-    } else {
-        std::cout << "Unable to load file." << std::endl;
+
+        if (!traceFile.empty()) {
+            std::ofstream trace{traceFile};
+            writeTrace(trace, {TraceTrack{inputs[0], &result.stats}});
+        }
+
+        return 0;
+    }
+
+    Driver driver{options, jobs};
+
+    for (const std::string& input : inputs) {
+        if (!driver.addInput(input)) {
+            std::cout << "Unable to read " << input << "." << std::endl;
+            return 1;
+        }
+    }
+
+    // Anything but a single file is compiled as a batch, in parallel. Batches
+    // aren't run, as the programs would have to share the input.
+    if (inputs.size() > 1 || driver.files().size() != 1 ||
+        driver.files()[0] != inputs[0]) {
+        bool compiled = driver.run(std::cout);
+
+        if (printStats) {
+            driver.stats().print(std::cout);
+        }
+
+        if (!traceFile.empty()) {
+            std::ofstream trace{traceFile};
+            driver.writeTrace(trace);
+        }
+
+        return compiled ? 0 : 1;
+    }
+
+    const std::string& fileName = inputs[0];
+    CompileResult result = compileFile(fileName, options);
+
+    if (!options.resultCache.empty()) {
+        ResultCache{options.resultCache}.trim(options.resultCacheLimit);
+    }
+    Stats* stats = options.stats ? &result.stats : nullptr;
+    {
+        Stats::Timer timer{stats, Stats::Phase::FORMAT};
+        print(fileName, result, options);
+    }
+
+    int status = 0;
+
+    // A program that was to be run but couldn't be compiled fails the run.
+    // Without --run or --batch the status is 0 whether or not the file
+    // compiled.
+    if ((run || !batchInput.empty()) &&
+        result.status != CompileResult::Status::COMPILED) {
+        status = 1;
+    } else if (run) {
+        Stats::Timer timer{stats, Stats::Phase::RUN};
+        status = execute(result.bytecode, jit) ? 0 : 1;
+    } else if (!batchInput.empty()) {
+        Stats::Timer timer{stats, Stats::Phase::RUN};
+        status = executeBatch(result.bytecode, batchInput, batchOutput) ? 0 : 1;
+    }
+
+    if (printStats) {
+        result.stats.print(std::cout);
+    }
+
+    if (!traceFile.empty()) {
+        std::ofstream trace{traceFile};
+        writeTrace(trace, {TraceTrack{fileName, &result.stats}});
     }
 
-    return 0;
+    return status;
 }